@@ -4,21 +4,41 @@
 #include <furi_hal_bt.h> // Then include specific BT HAL
 #include <furi_hal_resources.h> // Include resources definitions
 #include <stdint.h>
+#include <stdatomic.h>
 #include <string.h>
 #include "bt_hal_compat.h" // Include our compatibility layer
 #include "furi_hal_bt_custom.h" // Include our custom BT declarations
+#include "file_protocol.h"
 
 #define TAG "BtService" // Define TAG for logging
 
-#define FILE_CONTROL_START 0x01
-#define FILE_CONTROL_END   0x02
-#define FILE_CONTROL_ERROR 0xFF
+// Largest frame built here; bigger negotiated packets are clamped to it
+#define BT_FRAME_SIZE_MAX 512
+
+// Retry delay doubles on every failed attempt and resets after a success
+#define BT_BACKOFF_MIN_MS 5
+#define BT_BACKOFF_MAX_MS 320
+#define BT_SEND_ATTEMPTS  6
+
+// Status changes are queued by the HAL callback and delivered by their own thread
+#define BT_STATUS_QUEUE_SIZE 8
+#define BT_STATUS_STACK_SIZE 1024
+#define BT_STATUS_FLAG_STOP  (1 << 0)
+#define BT_STATUS_POLL_MS    100
 
 static BtEventCallback status_callback = NULL;
 static void* status_context = NULL;
+// Guards the subscriber only; never held while data is sent
+static FuriMutex* status_mutex = NULL;
+static FuriMessageQueue* status_queue = NULL;
+static FuriThread* status_thread = NULL;
 static FuriMutex* bt_mutex = NULL;
-static BtStatus current_bt_status = BtStatusOff; // Track internal status
+// Published without a lock so a transfer holding bt_mutex sees disconnects immediately
+static _Atomic BtStatus current_bt_status = BtStatusOff;
 static FuriHalBtStatusCallback hal_callback_handle = NULL;
+static BleFileServiceStats tx_stats;
+static FileProtocolSender tx_sender;
+static uint8_t tx_frame[BT_FRAME_SIZE_MAX];
 
 // Internal HAL status callback
 static void bt_hal_status_callback(FuriHalBtStatus status, void* context) {
@@ -42,20 +62,33 @@ static void bt_hal_status_callback(FuriHalBtStatus status, void* context) {
         break;
     }
 
-    // Update status and notify subscriber if changed
-    if(furi_mutex_acquire(bt_mutex, FuriWaitForever) == FuriStatusOk) {
-        if(current_bt_status != new_status) {
-            FURI_LOG_I(TAG, "BT HAL Status Changed: %d -> %d", current_bt_status, new_status);
-            current_bt_status = new_status;
-            if(status_callback) {
-                // Run user callback outside mutex if possible, or ensure it's quick
-                status_callback(current_bt_status, status_context);
-            }
+    // Publish first, then queue the change for the subscriber; this runs in the BT stack's
+    // context and must never wait
+    BtStatus old_status = atomic_exchange(&current_bt_status, new_status);
+    if(old_status != new_status) {
+        FURI_LOG_I(TAG, "BT HAL Status Changed: %d -> %d", old_status, new_status);
+        if(furi_message_queue_put(status_queue, &new_status, 0) != FuriStatusOk) {
+            FURI_LOG_W(TAG, "Status queue full, dropped %d", new_status);
         }
-        furi_mutex_release(bt_mutex);
     }
 }
 
+static int32_t bt_status_thread(void* context) {
+    UNUSED(context);
+    BtStatus status;
+
+    while(!(furi_thread_flags_get() & BT_STATUS_FLAG_STOP)) {
+        if(furi_message_queue_get(status_queue, &status, BT_STATUS_POLL_MS) != FuriStatusOk) {
+            continue;
+        }
+        furi_mutex_acquire(status_mutex, FuriWaitForever);
+        if(status_callback) status_callback(status, status_context);
+        furi_mutex_release(status_mutex);
+    }
+
+    return 0;
+}
+
 bool bt_service_init(void) {
     if(bt_mutex) return true; // Already initialized
 
@@ -64,6 +97,8 @@ bool bt_service_init(void) {
         FURI_LOG_E(TAG, "Failed to allocate mutex");
         return false;
     }
+    status_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    status_queue = furi_message_queue_alloc(BT_STATUS_QUEUE_SIZE, sizeof(BtStatus));
 
     bool success = false;
     if(furi_mutex_acquire(bt_mutex, FuriWaitForever) == FuriStatusOk) {
@@ -72,7 +107,10 @@ bool bt_service_init(void) {
             if(furi_hal_bt_is_active()) {
                 status_callback = NULL;
                 status_context = NULL;
-                current_bt_status = BtStatusOff; // Initial state
+                atomic_store(&current_bt_status, BtStatusOff); // Initial state
+                status_thread = furi_thread_alloc_ex(
+                    "BtStatus", BT_STATUS_STACK_SIZE, bt_status_thread, NULL);
+                furi_thread_start(status_thread);
 
                 // Register HAL status callback
                 hal_callback_handle =
@@ -95,6 +133,10 @@ bool bt_service_init(void) {
     }
 
     if(!success) {
+        furi_message_queue_free(status_queue);
+        status_queue = NULL;
+        furi_mutex_free(status_mutex);
+        status_mutex = NULL;
         furi_mutex_free(bt_mutex);
         bt_mutex = NULL;
         FURI_LOG_E(TAG, "BT Service Initialization Failed");
@@ -115,15 +157,23 @@ void bt_service_deinit(void) {
         hal_callback_handle = NULL;
     }
 
-    // Clean up BT status callback
-    if(furi_mutex_acquire(bt_mutex, FuriWaitForever) == FuriStatusOk) {
-        status_callback = NULL;
-        status_context = NULL;
-        current_bt_status = BtStatusOff;
-        furi_mutex_release(bt_mutex);
+    // No more HAL callbacks can arrive, so the status thread can stop
+    if(status_thread) {
+        furi_thread_flags_set(furi_thread_get_id(status_thread), BT_STATUS_FLAG_STOP);
+        furi_thread_join(status_thread);
+        furi_thread_free(status_thread);
+        status_thread = NULL;
     }
 
-    // Free mutex last
+    status_callback = NULL;
+    status_context = NULL;
+    atomic_store(&current_bt_status, BtStatusOff);
+    furi_message_queue_free(status_queue);
+    status_queue = NULL;
+
+    // Free mutexes last
+    furi_mutex_free(status_mutex);
+    status_mutex = NULL;
     furi_mutex_free(bt_mutex);
     bt_mutex = NULL;
     FURI_LOG_I(TAG, "BT Service Deinitialized");
@@ -134,25 +184,25 @@ void bt_service_subscribe_status(BtEventCallback callback, void* context) {
         FURI_LOG_W(TAG, "Cannot subscribe, BT service not initialized");
         return;
     }
-    if(furi_mutex_acquire(bt_mutex, FuriWaitForever) == FuriStatusOk) {
+    if(furi_mutex_acquire(status_mutex, FuriWaitForever) == FuriStatusOk) {
         status_callback = callback;
         status_context = context;
 
         if(callback) {
             // Immediately report current status
-            callback(current_bt_status, context);
+            callback(atomic_load(&current_bt_status), context);
         }
-        furi_mutex_release(bt_mutex);
+        furi_mutex_release(status_mutex);
     }
 }
 
 void bt_service_unsubscribe_status(void) {
     if(!bt_mutex) return; // Not initialized
 
-    if(furi_mutex_acquire(bt_mutex, FuriWaitForever) == FuriStatusOk) {
+    if(furi_mutex_acquire(status_mutex, FuriWaitForever) == FuriStatusOk) {
         status_callback = NULL;
         status_context = NULL;
-        furi_mutex_release(bt_mutex);
+        furi_mutex_release(status_mutex);
     }
 }
 
@@ -165,7 +215,7 @@ bool ble_file_service_init(void) {
 
     if(furi_mutex_acquire(bt_mutex, FuriWaitForever) == FuriStatusOk) {
         if(bt_is_active()) {
-            // Placeholder for actual file service profile setup if needed
+            memset(&tx_stats, 0, sizeof(tx_stats));
             success = true;
             FURI_LOG_I(TAG, "BLE File Service Ready");
         } else {
@@ -177,13 +227,35 @@ bool ble_file_service_init(void) {
     return success;
 }
 
+// Transmit one packet, backing off after failures
+static bool ble_file_service_send_packet(const uint8_t* data, uint16_t size) {
+    uint32_t backoff_ms = BT_BACKOFF_MIN_MS;
+
+    for(uint8_t attempt = 0; attempt < BT_SEND_ATTEMPTS; attempt++) {
+        if(atomic_load(&current_bt_status) != BtStatusConnected) {
+            FURI_LOG_W(TAG, "Send attempt failed: BT disconnected");
+            return false;
+        }
+
+        int32_t sent = bt_serial_tx(data, size);
+        if(sent == (int32_t)size) return true;
+        FURI_LOG_W(TAG, "Chunk send failed (ret %ld), attempt %d", sent, attempt + 1);
+
+        tx_stats.retries++;
+        furi_delay_ms(backoff_ms);
+        if(backoff_ms < BT_BACKOFF_MAX_MS) backoff_ms *= 2;
+    }
+
+    return false;
+}
+
 bool ble_file_service_send(uint8_t* data, size_t size) {
     if(!bt_mutex) return false;
 
     bool success = false;
     if(furi_mutex_acquire(bt_mutex, FuriWaitForever) == FuriStatusOk) {
         // Check status inside the loop as well
-        if(current_bt_status != BtStatusConnected) {
+        if(atomic_load(&current_bt_status) != BtStatusConnected) {
             FURI_LOG_W(TAG, "Send failed: BT not connected");
             furi_mutex_release(bt_mutex);
             return false;
@@ -198,54 +270,39 @@ bool ble_file_service_send(uint8_t* data, size_t size) {
             return false;
         }
 
-        size_t remaining = size;
+        size_t frame_capacity =
+            max_ble_packet_size < BT_FRAME_SIZE_MAX ? max_ble_packet_size : BT_FRAME_SIZE_MAX;
+        uint32_t start_tick = furi_get_tick();
         size_t offset = 0;
         success = true; // Assume success unless a chunk fails
 
-        while(remaining > 0) {
-            // Re-check status inside the loop
-            if(current_bt_status != BtStatusConnected) {
-                FURI_LOG_W(TAG, "Send failed: BT disconnected during transfer");
+        // No fixed pacing: packets go out as fast as the stack accepts them
+        while(offset < size) {
+            size_t frame_size;
+            size_t used = file_protocol_build_data(
+                &tx_sender, tx_frame, frame_capacity, data + offset, size - offset, &frame_size);
+            if(used == 0) {
+                FURI_LOG_E(TAG, "Send failed: packet size %u leaves no room", max_ble_packet_size);
                 success = false;
                 break;
             }
-
-            size_t chunk_size = remaining > max_ble_packet_size ? max_ble_packet_size : remaining;
-            bool sent_success = false;
-            // Retry sending a chunk a few times
-            for(uint8_t attempts = 0; attempts < 3 && !sent_success; attempts++) {
-                // Re-check status before each attempt
-                if(current_bt_status != BtStatusConnected) {
-                    FURI_LOG_W(TAG, "Send attempt failed: BT disconnected");
-                    success = false;
-                    break; // Break retry loop
-                }
-
-                // Use a temporary buffer on stack or ensure bt_serial_tx handles const data
-                // bt_serial_tx takes const uint8_t*, so direct pointer is fine
-                int32_t sent = bt_serial_tx(data + offset, (uint16_t)chunk_size);
-
-                if(sent == (int32_t)chunk_size) {
-                    sent_success = true;
-                } else {
-                    FURI_LOG_W(TAG, "Chunk send failed (ret %ld), attempt %d", sent, attempts + 1);
-                    furi_delay_ms(20); // Increase delay slightly before retry
-                }
+            if(frame_size && !ble_file_service_send_packet(tx_frame, (uint16_t)frame_size)) {
+                FURI_LOG_E(TAG, "Failed to send chunk at offset %lu", tx_sender.offset);
+                success = false;
+                break;
             }
 
-            if(!success) break; // Break while loop if BT disconnected during retries
-
-            if(!sent_success) {
-                FURI_LOG_E(TAG, "Failed to send chunk after retries");
-                success = false;
-                break; // Exit the while loop if a chunk fails definitively
+            offset += used;
+            if(frame_size) {
+                tx_stats.packets_sent++;
+                tx_stats.bytes_sent += used;
             }
+        }
 
-            offset += chunk_size;
-            remaining -= chunk_size;
-            // Add a small delay between packets to avoid overwhelming the receiver
-            // This value might need tuning
-            furi_delay_ms(10); // Keep a small delay
+        tx_stats.elapsed_ms += furi_get_tick() - start_tick;
+        if(tx_stats.elapsed_ms > 0) {
+            tx_stats.bytes_per_second =
+                (uint32_t)((uint64_t)tx_stats.bytes_sent * 1000 / tx_stats.elapsed_ms);
         }
         furi_mutex_release(bt_mutex);
     } else {
@@ -254,51 +311,64 @@ bool ble_file_service_send(uint8_t* data, size_t size) {
     return success;
 }
 
+void ble_file_service_handle_rx(const uint8_t* data, size_t size) {
+    FileFrameHeader header;
+    const uint8_t* payload;
+    if(!bt_mutex || !file_protocol_parse(data, size, &header, &payload)) return;
+    if(header.type != FileFrameTypeResume) return;
+
+    if(furi_mutex_acquire(bt_mutex, FuriWaitForever) == FuriStatusOk) {
+        file_protocol_sender_resume(&tx_sender, &header);
+        FURI_LOG_I(TAG, "Receiver resumes at %lu", header.offset);
+        furi_mutex_release(bt_mutex);
+    }
+}
+
+void ble_file_service_get_stats(BleFileServiceStats* stats) {
+    if(!bt_mutex) {
+        memset(stats, 0, sizeof(BleFileServiceStats));
+        return;
+    }
+    if(furi_mutex_acquire(bt_mutex, FuriWaitForever) == FuriStatusOk) {
+        *stats = tx_stats;
+        furi_mutex_release(bt_mutex);
+    }
+}
+
 bool ble_file_service_start_transfer(const char* file_name, uint32_t file_size) {
     if(!bt_mutex) return false;
 
     bool success = false;
     if(furi_mutex_acquire(bt_mutex, FuriWaitForever) == FuriStatusOk) {
         // Check if connected before starting
-        if(current_bt_status != BtStatusConnected) {
+        if(atomic_load(&current_bt_status) != BtStatusConnected) {
             FURI_LOG_W(TAG, "Start transfer failed: BT not connected");
             furi_mutex_release(bt_mutex);
             return false;
         }
 
-        // Get max packet size for buffer allocation, ensure it's large enough for header
+        // The start frame needs room for its header, file info and some of the name
         uint16_t max_packet_size = bt_get_max_packet_size();
-        if(max_packet_size < 64) { // Need space for control, size, and some name
+        if(max_packet_size < 64) {
             FURI_LOG_E(
                 TAG, "Start transfer failed: Max packet size too small (%d)", max_packet_size);
             furi_mutex_release(bt_mutex);
             return false;
         }
 
-        uint8_t start_packet[max_packet_size]; // Use dynamic size
-        memset(start_packet, 0, sizeof(start_packet)); // Clear the buffer
-
-        start_packet[0] = FILE_CONTROL_START;
-        // Pack file size (Big Endian)
-        start_packet[1] = (file_size >> 24) & 0xFF;
-        start_packet[2] = (file_size >> 16) & 0xFF;
-        start_packet[3] = (file_size >> 8) & 0xFF;
-        start_packet[4] = file_size & 0xFF;
-
-        // Pack file name, ensuring null termination within buffer limits if possible
-        size_t name_len = strlen(file_name);
-        // Calculate max name length based on actual max_packet_size
-        size_t max_name_len = max_packet_size - 5 - 1;
-        if(name_len > max_name_len) {
-            name_len = max_name_len;
+        // Built in the preallocated frame rather than on the caller's stack, whatever MTU
+        // was negotiated
+        size_t frame_capacity =
+            max_packet_size < BT_FRAME_SIZE_MAX ? max_packet_size : BT_FRAME_SIZE_MAX;
+        size_t packet_len =
+            file_protocol_build_start(tx_frame, frame_capacity, file_name, file_size, 0);
+        if(packet_len < FILE_FRAME_HEADER_SIZE + sizeof(FileStartInfo) + strlen(file_name)) {
             FURI_LOG_W(TAG, "Filename truncated for BLE transfer");
         }
-        memcpy(&start_packet[5], file_name, name_len);
-        start_packet[5 + name_len] = '\0'; // Null-terminate the name
-
-        size_t packet_len = 5 + name_len + 1; // Include null terminator
+        file_protocol_sender_reset(&tx_sender);
+        memset(&tx_stats, 0, sizeof(tx_stats));
 
-        int32_t sent = bt_serial_tx(start_packet, (uint16_t)packet_len);
+        int32_t sent = bt_serial_tx(tx_frame, (uint16_t)packet_len);
         success = (sent == (int32_t)packet_len);
 
         if(!success) {
@@ -318,17 +388,23 @@ bool ble_file_service_end_transfer(void) {
     bool success = false;
     if(furi_mutex_acquire(bt_mutex, FuriWaitForever) == FuriStatusOk) {
         // Check if connected before sending end packet
-        if(current_bt_status != BtStatusConnected) {
+        if(atomic_load(&current_bt_status) != BtStatusConnected) {
             // Don't log error here, might be normal if disconnected just before this call
             furi_mutex_release(bt_mutex);
             return false;
         }
-        uint8_t end_packet[1] = {FILE_CONTROL_END};
-        int32_t sent = bt_serial_tx(end_packet, 1);
-        success = (sent == 1);
+        size_t packet_len = file_protocol_build_end(&tx_sender, tx_frame, sizeof(tx_frame));
+        int32_t sent = bt_serial_tx(tx_frame, (uint16_t)packet_len);
+        success = (sent == (int32_t)packet_len);
         if(!success) {
             FURI_LOG_E(TAG, "Failed to send end transfer packet (ret %ld)", sent);
         }
+        FURI_LOG_I(
+            TAG,
+            "Transfer done: %lu bytes, %lu B/s, %lu retries",
+            tx_stats.bytes_sent,
+            tx_stats.bytes_per_second,
+            tx_stats.retries);
         furi_mutex_release(bt_mutex);
     } else {
         FURI_LOG_E(TAG, "End transfer failed: Could not acquire mutex");
@@ -341,13 +417,12 @@ void ble_file_service_deinit(void) {
 
     // Send error packet only if BT is currently connected
     if(furi_mutex_acquire(bt_mutex, FuriWaitForever) == FuriStatusOk) {
-        if(current_bt_status == BtStatusConnected) {
-            uint8_t error_packet[1] = {FILE_CONTROL_ERROR};
+        if(atomic_load(&current_bt_status) == BtStatusConnected) {
+            size_t packet_len = file_protocol_build_error(tx_frame, sizeof(tx_frame));
             // Best effort send, ignore result
-            bt_serial_tx(error_packet, 1);
+            bt_serial_tx(tx_frame, (uint16_t)packet_len);
             FURI_LOG_I(TAG, "Sent error packet during deinit");
         }
-        // Placeholder for actual file service profile teardown if needed
         furi_mutex_release(bt_mutex);
     }
     // No need to log error if mutex acquisition fails here
@@ -8,6 +8,15 @@
 // Using the BtStatus enum defined in docview.h
 typedef void (*BtEventCallback)(BtStatus event, void* context);
 
+// Counters of the current transfer, reset by ble_file_service_start_transfer()
+typedef struct {
+    uint32_t bytes_sent;
+    uint32_t packets_sent;
+    uint32_t retries;        // Transmit attempts that failed and were backed off
+    uint32_t elapsed_ms;     // Time spent inside ble_file_service_send()
+    uint32_t bytes_per_second;
+} BleFileServiceStats;
+
 // Service functions
 bool bt_service_init(void);
 void bt_service_deinit(void);
@@ -19,4 +28,7 @@ bool ble_file_service_init(void);
 bool ble_file_service_send(uint8_t* data, size_t size);
 bool ble_file_service_start_transfer(const char* file_name, uint32_t file_size);
 bool ble_file_service_end_transfer(void);
+// Feed a frame received from the peer; resume frames move the next transfer forward
+void ble_file_service_handle_rx(const uint8_t* data, size_t size);
+void ble_file_service_get_stats(BleFileServiceStats* stats);
 void ble_file_service_deinit(void);
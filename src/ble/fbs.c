@@ -2,12 +2,116 @@
 #include <ble_profile_serial.h> // correct SDK header under lib/ble_profile
 #include <storage/storage.h>
 #include <stdio.h>
+#include <string.h>
+#include "lz_stream.h"
+#include "../reader/block_cache.h"
+
+#define TAG "Fbs"
+
+#define FBS_READER_STACK_SIZE 1024
+#define FBS_RX_BUFFER_SIZE    256
+// How long the receiver gets to answer a start frame with its resume point
+#define FBS_RESUME_WAIT_MS 1000
+
+// Frames on air that the receiver has not confirmed yet. The serial characteristic indicates,
+// and the stack keeps one indication outstanding, so a frame waits for the previous one's
+// confirmation, which the profile reports as SerialServiceEventTypeDataSent.
+#define FBS_TX_CREDITS 1
+// A receiver that stops confirming for this long has gone; the transfer can be resumed
+#define FBS_TX_CONFIRM_TIMEOUT_MS 5000
+#define FBS_TX_POLL_MS            100
+// A frame the stack refuses goes out again after a pause that doubles on every refusal
+#define FBS_TX_ATTEMPTS       6
+#define FBS_TX_BACKOFF_MIN_MS 5
+#define FBS_TX_BACKOFF_MAX_MS 160
+
+#define FBS_RECEIVE_POLL_MS 50
+#define FBS_RECEIVE_EVENTS  4
+#define FBS_RECEIVE_CHUNK   256
+#define FBS_RECEIVE_NAME    "received.txt"
 
 static BleProfileSerial* svc = NULL;
 static bool connected = false;
+static uint32_t last_throughput = 0;
+static uint32_t tx_retries = 0; // Of the transfer in progress or the last one
+static FuriSemaphore* resume_signal = NULL;
+static FuriSemaphore* tx_credits = NULL;
+static FileFrameHeader resume_frame;
+
+typedef struct {
+    uint8_t data[FBS_FRAME_SIZE]; // Header, then the payload read from storage
+    size_t length; // Payload bytes; 0 marks end of file, a read error or a stop request
+} FbsFrame;
+
+// Frames cycle between the two queues: the reader fills free ones, the sender drains full ones
+typedef struct {
+    File* file;
+    // Payloads come through the block cache, so a file just viewed is sent from RAM
+    BlockCacheFile id;
+    uint32_t read_offset;
+    FbsFrame frames[FBS_FRAME_POOL_SIZE];
+    FuriMessageQueue* free_frames;
+    FuriMessageQueue* full_frames;
+    volatile bool stop;
+
+    FileProtocolSender sender;
+    // Start, end and compressed data frames, which do not come from the pool
+    uint8_t frame[FBS_FRAME_SIZE];
+
+    // Only when the receiver accepted FILE_FLAG_LZ
+    LzEncoder* encoder;
+} FbsPipeline;
+
+// Allocated with the profile so a transfer never needs more than its queues and thread
+static FbsPipeline* pipeline = NULL;
+
+// A start frame as the BLE callback accepted it. Data frames that follow move the protocol
+// on before the thread gets to the start event, so the thread opens the file from this.
+typedef struct {
+    FileProtocolReceiver protocol;
+    uint32_t mark; // Payload bytes queued before it; the ones after belong to its file
+} FbsReceiveStart;
+
+// Incoming file: the BLE callback checks frames and queues their payloads and events, the
+// thread in fbs_receive_file() decodes them and writes whole sectors to the card
+typedef struct {
+    FuriStreamBuffer* data;
+    FuriMessageQueue* events;
+    // Both threads use the protocol state and the starts; every access goes through this lock
+    FuriMutex* lock;
+    FileProtocolReceiver protocol; // Kept across calls so an interrupted file can resume
+    // One per start event still queued, oldest first
+    FbsReceiveStart starts[FBS_RECEIVE_EVENTS];
+    uint32_t starts_queued;
+    uint32_t starts_taken;
+    uint32_t queued; // Payload bytes the callback put into 'data'
+    uint32_t taken; // Payload bytes the thread took out, only touched by the thread
+    uint32_t dropped; // Frames refused because the buffer was full
+    volatile bool woken; // A data event is queued to wake the thread; one is enough
+
+    File* file;
+    bool open;
+    LzDecoder* decoder; // Only while the sender compresses
+    uint32_t file_size; // Announced in the start frame; decoded output may not pass it
+    uint32_t decoded; // Bytes the decoder has produced
+    uint8_t packed[FBS_RECEIVE_CHUNK];
+    size_t packed_length;
+    size_t packed_pos;
+    uint8_t block[FBS_WRITE_SIZE];
+    size_t used;
+    uint32_t written; // File offset of block[0]
+} FbsReceiver;
+
+// Allocated by the first fbs_receive_file(); only touched by the callback while receiving
+static FbsReceiver* receiver = NULL;
+static volatile bool receiving = false;
 
 static void on_connect(void* ctx) {
     (void)ctx;
+    // Confirmations lost with the last link never come back
+    while(furi_semaphore_get_count(tx_credits) < FBS_TX_CREDITS) {
+        furi_semaphore_release(tx_credits);
+    }
     connected = true;
 }
 static void on_disconnect(void* ctx) {
@@ -15,14 +119,225 @@ static void on_disconnect(void* ctx) {
     connected = false;
 }
 
+// Runs in the BLE stack's context: check the frame and hand it on without waiting
+static void fbs_receive_frame(const uint8_t* data, size_t size) {
+    // A frame that does not fit is dropped before the protocol sees it. The gap it leaves
+    // breaks the transfer, and the sender's next start frame resumes from the last good byte.
+    if(furi_stream_buffer_spaces_available(receiver->data) < size) {
+        receiver->dropped++;
+        return;
+    }
+
+    const uint8_t* payload;
+    size_t length;
+    furi_mutex_acquire(receiver->lock, FuriWaitForever);
+    bool was_active = receiver->protocol.active;
+    FileReceiveEvent event =
+        file_protocol_receive(&receiver->protocol, data, size, &payload, &length);
+    if(event == FileReceiveEventStart) {
+        if(receiver->starts_queued - receiver->starts_taken < FBS_RECEIVE_EVENTS &&
+           furi_message_queue_put(receiver->events, &event, 0) == FuriStatusOk) {
+            FbsReceiveStart* start =
+                &receiver->starts[receiver->starts_queued++ % FBS_RECEIVE_EVENTS];
+            start->protocol = receiver->protocol;
+            start->mark = receiver->queued;
+        } else {
+            // Data the thread never opened a file for would go to the last one; refuse it
+            // until the sender starts again
+            receiver->protocol.active = false;
+        }
+        event = FileReceiveEventNone;
+    } else if(event == FileReceiveEventData) {
+        receiver->queued += furi_stream_buffer_send(receiver->data, payload, length, 0);
+    }
+    furi_mutex_release(receiver->lock);
+    if(event == FileReceiveEventData) {
+        // Without this the thread would only notice the data on its next poll, by which
+        // time a fast sender has filled the buffer
+        if(!receiver->woken) {
+            // Set first: the thread may take the event and clear the flag before put returns
+            receiver->woken = true;
+            if(furi_message_queue_put(receiver->events, &event, 0) != FuriStatusOk) {
+                receiver->woken = false;
+            }
+        }
+    } else if(event == FileReceiveEventError && !was_active) {
+        // Every frame after a break fails the same way; one report is enough
+    } else if(event != FileReceiveEventNone) {
+        furi_message_queue_put(receiver->events, &event, 0);
+    }
+}
+
+static uint16_t on_serial_event(SerialServiceEvent event, void* ctx) {
+    (void)ctx;
+    if(event.event == SerialServiceEventTypeDataSent) {
+        furi_semaphore_release(tx_credits);
+    } else if(event.event == SerialServiceEventTypeDataReceived) {
+        if(receiving) {
+            fbs_receive_frame(event.data.buffer, event.data.size);
+        } else {
+            FileFrameHeader header;
+            const uint8_t* payload;
+            if(file_protocol_parse(event.data.buffer, event.data.size, &header, &payload) &&
+               header.type == FileFrameTypeResume) {
+                resume_frame = header;
+                furi_semaphore_release(resume_signal);
+            }
+        }
+    }
+
+    if(receiving) {
+        size_t space = furi_stream_buffer_spaces_available(receiver->data);
+        return space < FBS_RX_BUFFER_SIZE ? space : FBS_RX_BUFFER_SIZE;
+    }
+    return FBS_RX_BUFFER_SIZE;
+}
+
 bool fbs_init(void) {
+    if(svc) return true;
     svc = ble_profile_serial_init();
     if(!svc) return false;
+    pipeline = malloc(sizeof(FbsPipeline));
+    resume_signal = furi_semaphore_alloc(1, 0);
+    tx_credits = furi_semaphore_alloc(FBS_TX_CREDITS, FBS_TX_CREDITS);
     ble_profile_serial_set_connection_callbacks(svc, on_connect, on_disconnect, NULL);
+    ble_profile_serial_set_event_callback(svc, FBS_RX_BUFFER_SIZE, on_serial_event, NULL);
     return true;
 }
 
-bool fbs_send_file(const char* path) {
+bool fbs_is_connected(void) {
+    return svc && connected;
+}
+
+// Transmit one frame once a credit is free. Credits only come back when the receiver
+// confirms a frame, so the sender never runs ahead of what has actually been delivered.
+static bool fbs_tx(uint8_t* data, size_t size) {
+    uint32_t waited_ms = 0;
+    while(furi_semaphore_acquire(tx_credits, furi_ms_to_ticks(FBS_TX_POLL_MS)) != FuriStatusOk) {
+        waited_ms += FBS_TX_POLL_MS;
+        if(!connected) return false;
+        if(waited_ms >= FBS_TX_CONFIRM_TIMEOUT_MS) {
+            FURI_LOG_W(TAG, "No confirmation for %lu ms", waited_ms);
+            return false;
+        }
+    }
+
+    uint32_t backoff_ms = FBS_TX_BACKOFF_MIN_MS;
+    for(uint32_t attempt = 1; !ble_profile_serial_tx(svc, data, size); attempt++) {
+        if(!connected || attempt == FBS_TX_ATTEMPTS) {
+            // Nothing went on air, so no confirmation will return this credit
+            furi_semaphore_release(tx_credits);
+            return false;
+        }
+        tx_retries++;
+        furi_delay_ms(backoff_ms);
+        if(backoff_ms < FBS_TX_BACKOFF_MAX_MS) backoff_ms *= 2;
+    }
+    return true;
+}
+
+static int32_t fbs_reader_thread(void* context) {
+    UNUSED(context);
+    uint8_t index;
+    size_t length;
+
+    do {
+        furi_message_queue_get(pipeline->free_frames, &index, FuriWaitForever);
+        FbsFrame* frame = &pipeline->frames[index];
+        frame->length = 0;
+        if(!pipeline->stop) {
+            frame->length = block_cache_read(
+                &pipeline->id,
+                pipeline->file,
+                pipeline->read_offset,
+                frame->data + FILE_FRAME_HEADER_SIZE,
+                FBS_FRAME_PAYLOAD,
+                BlockCacheHintSequential);
+            pipeline->read_offset += frame->length;
+        }
+        length = frame->length;
+        furi_message_queue_put(pipeline->full_frames, &index, FuriWaitForever);
+    } while(length > 0);
+
+    return 0;
+}
+
+// Frame and send a payload that already sits in the body of 'frame'. Bytes below the
+// receiver's resume point are only checksummed, so the frame may go out shorter or not at all.
+static bool fbs_send_in_place(uint8_t* frame, size_t length) {
+    uint8_t* body = frame + FILE_FRAME_HEADER_SIZE;
+    for(size_t offset = 0; offset < length;) {
+        size_t frame_size;
+        offset += file_protocol_build_data(
+            &pipeline->sender, frame, FBS_FRAME_SIZE, body + offset, length - offset, &frame_size);
+        if(frame_size && !fbs_tx(frame, frame_size)) return false;
+    }
+    return true;
+}
+
+// Send whatever compressed output is ready, encoded straight into a frame body
+static bool fbs_drain_encoder(void) {
+    for(;;) {
+        size_t size = lz_encoder_poll(
+            pipeline->encoder, pipeline->frame + FILE_FRAME_HEADER_SIZE, FBS_FRAME_PAYLOAD);
+        if(size == 0) return true;
+        if(!fbs_send_in_place(pipeline->frame, size)) return false;
+    }
+}
+
+static bool fbs_send_frame(FbsFrame* frame) {
+    if(!pipeline->encoder) return fbs_send_in_place(frame->data, frame->length);
+
+    const uint8_t* body = frame->data + FILE_FRAME_HEADER_SIZE;
+    for(size_t offset = 0; offset < frame->length;) {
+        offset += lz_encoder_sink(pipeline->encoder, body + offset, frame->length - offset);
+        if(!fbs_drain_encoder()) return false;
+    }
+    return true;
+}
+
+// Announce the file and pick up where the receiver left off, if it reports a position
+static bool fbs_send_start(const char* path, uint32_t total, bool compress) {
+    const char* name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+
+    size_t size = file_protocol_build_start(
+        pipeline->frame, sizeof(pipeline->frame), name, total, compress ? FILE_FLAG_LZ : 0);
+    furi_semaphore_acquire(resume_signal, 0);
+    if(!fbs_tx(pipeline->frame, size)) return false;
+
+    if(furi_semaphore_acquire(resume_signal, furi_ms_to_ticks(FBS_RESUME_WAIT_MS)) ==
+       FuriStatusOk) {
+        if(resume_frame.offset <= total) {
+            file_protocol_sender_resume(&pipeline->sender, &resume_frame);
+            FURI_LOG_I(TAG, "Resuming at %lu", pipeline->sender.resume_offset);
+        }
+    }
+
+    // Receivers that never answer get raw data
+    if(pipeline->sender.flags & FILE_FLAG_LZ) {
+        pipeline->encoder = lz_encoder_alloc();
+    }
+    return true;
+}
+
+static void fbs_send_end(bool ok) {
+    if(ok && pipeline->encoder) {
+        lz_encoder_finish(pipeline->encoder);
+        ok = fbs_drain_encoder();
+    }
+
+    size_t size = ok ? file_protocol_build_end(
+                           &pipeline->sender, pipeline->frame, sizeof(pipeline->frame)) :
+                       file_protocol_build_error(pipeline->frame, sizeof(pipeline->frame));
+    if(connected) fbs_tx(pipeline->frame, size);
+}
+
+bool fbs_send_file(
+    const char* path,
+    bool compress,
+    FbsProgressCallback callback,
+    void* context) {
     if(!svc || !connected) return false;
     Storage* storage = furi_record_open(RECORD_STORAGE);
     File* f = storage_file_alloc(storage);
@@ -31,20 +346,384 @@ bool fbs_send_file(const char* path) {
         furi_record_close(RECORD_STORAGE);
         return false;
     }
-    uint8_t buf[256];
-    size_t rd;
-    while((rd = storage_file_read(f, buf, sizeof(buf))) > 0) {
-        if(!ble_profile_serial_tx(svc, buf, rd)) break;
+    uint32_t total = (uint32_t)storage_file_size(f);
+    uint32_t sent = 0;
+    bool ok = true;
+
+    pipeline->file = f;
+    tx_retries = 0;
+    block_cache_file(&pipeline->id, path, total);
+    pipeline->read_offset = 0;
+    pipeline->stop = false;
+    pipeline->encoder = NULL;
+    pipeline->free_frames = furi_message_queue_alloc(FBS_FRAME_POOL_SIZE, sizeof(uint8_t));
+    pipeline->full_frames = furi_message_queue_alloc(FBS_FRAME_POOL_SIZE, sizeof(uint8_t));
+    for(uint8_t i = 0; i < FBS_FRAME_POOL_SIZE; i++) {
+        furi_message_queue_put(pipeline->free_frames, &i, 0);
+    }
+    file_protocol_sender_reset(&pipeline->sender);
+    ok = fbs_send_start(path, total, compress);
+    // A failed start leaves the reader to sign off straight away
+    pipeline->stop = !ok;
+
+    // The next frames are read from storage while the current one is on air
+    FuriThread* reader =
+        furi_thread_alloc_ex("FbsReader", FBS_READER_STACK_SIZE, fbs_reader_thread, NULL);
+    furi_thread_start(reader);
+
+    uint32_t start_tick = furi_get_tick();
+    uint8_t index;
+    for(;;) {
+        furi_message_queue_get(pipeline->full_frames, &index, FuriWaitForever);
+        FbsFrame* frame = &pipeline->frames[index];
+        if(frame->length == 0) break;
+
+        if(ok) {
+            size_t length = frame->length;
+            ok = fbs_send_frame(frame);
+            if(ok) sent += length;
+            if(ok && callback) ok = callback(sent, total, context);
+            // Keep recycling frames until the reader has seen the request and signs off
+            if(!ok) pipeline->stop = true;
+        }
+        furi_message_queue_put(pipeline->free_frames, &index, FuriWaitForever);
+    }
+    uint32_t elapsed_ms = furi_get_tick() - start_tick;
+    fbs_send_end(ok && sent == total);
+    // Bytes skipped on resume never went on air
+    uint32_t resumed = pipeline->sender.resume_offset;
+    uint32_t on_air = sent > resumed ? sent - resumed : 0;
+    if(pipeline->encoder) {
+        FURI_LOG_I(TAG, "Compressed %lu bytes to %lu", sent, pipeline->sender.offset);
+        lz_encoder_free(pipeline->encoder);
     }
+
+    furi_thread_join(reader);
+    furi_thread_free(reader);
+    furi_message_queue_free(pipeline->free_frames);
+    furi_message_queue_free(pipeline->full_frames);
+
     storage_file_close(f);
     storage_file_free(f);
     furi_record_close(RECORD_STORAGE);
-    return true;
+
+    if(elapsed_ms == 0) elapsed_ms = 1;
+    last_throughput = (uint32_t)((uint64_t)on_air * 1000 / elapsed_ms);
+    FURI_LOG_I(
+        TAG,
+        "Sent %lu bytes in %lu ms, %lu B/s, %lu retries",
+        on_air,
+        elapsed_ms,
+        last_throughput,
+        tx_retries);
+
+    return ok && sent == total;
+}
+
+// A consistent copy of the protocol state the BLE callback keeps advancing
+static FileProtocolReceiver fbs_receive_protocol(void) {
+    furi_mutex_acquire(receiver->lock, FuriWaitForever);
+    FileProtocolReceiver protocol = receiver->protocol;
+    furi_mutex_release(receiver->lock);
+    return protocol;
+}
+
+static bool fbs_write_flush(void) {
+    if(receiver->used == 0) return true;
+    size_t size = receiver->used;
+    receiver->used = 0;
+    receiver->written += size;
+    return storage_file_write(receiver->file, receiver->block, size) == size;
+}
+
+// Room left in the block. After a resume the first write ends on a sector boundary, so every
+// later one is a whole, aligned block.
+static size_t fbs_write_room(void) {
+    return FBS_WRITE_SIZE - receiver->written % FBS_WRITE_ALIGN - receiver->used;
+}
+
+// Take queued payload bytes, never past those of the next start frame's file
+static size_t fbs_receive_take(uint8_t* out, size_t size) {
+    furi_mutex_acquire(receiver->lock, FuriWaitForever);
+    if(receiver->starts_queued != receiver->starts_taken) {
+        const FbsReceiveStart* next =
+            &receiver->starts[receiver->starts_taken % FBS_RECEIVE_EVENTS];
+        if(size > next->mark - receiver->taken) size = next->mark - receiver->taken;
+    }
+    furi_mutex_release(receiver->lock);
+    if(size == 0) return 0;
+    size = furi_stream_buffer_receive(receiver->data, out, size, 0);
+    receiver->taken += size;
+    return size;
+}
+
+// Throw away queued payload bytes up to 'mark'
+static void fbs_receive_discard(uint32_t mark) {
+    while(receiver->taken != mark) {
+        size_t size = sizeof(receiver->packed);
+        if(size > mark - receiver->taken) size = mark - receiver->taken;
+        if(fbs_receive_take(receiver->packed, size) == 0) break;
+    }
+}
+
+// Move everything the BLE callback has queued for the open file into it
+static bool fbs_receive_drain(void) {
+    for(;;) {
+        if(fbs_write_room() == 0 && !fbs_write_flush()) return false;
+        uint8_t* out = receiver->block + receiver->used;
+        size_t room = fbs_write_room();
+
+        if(!receiver->decoder) {
+            size_t size = fbs_receive_take(out, room);
+            if(size == 0) return true;
+            receiver->used += size;
+            continue;
+        }
+
+        size_t size = lz_decoder_poll(receiver->decoder, out, room);
+        if(size > 0) {
+            // The protocol cannot bound a compressed stream, so its output is checked here
+            if(size > receiver->file_size - receiver->decoded) {
+                FURI_LOG_W(TAG, "Stream decodes past %lu bytes", receiver->file_size);
+                return false;
+            }
+            receiver->decoded += size;
+            receiver->used += size;
+            continue;
+        }
+        if(receiver->packed_pos == receiver->packed_length) {
+            receiver->packed_length =
+                fbs_receive_take(receiver->packed, sizeof(receiver->packed));
+            receiver->packed_pos = 0;
+            if(receiver->packed_length == 0) return true;
+        }
+        receiver->packed_pos += lz_decoder_sink(
+            receiver->decoder,
+            receiver->packed + receiver->packed_pos,
+            receiver->packed_length - receiver->packed_pos);
+    }
+}
+
+static bool fbs_receive_close(void) {
+    if(!receiver->open) return true;
+    bool ok = fbs_write_flush();
+    storage_file_close(receiver->file);
+    receiver->open = false;
+    if(receiver->decoder) {
+        lz_decoder_free(receiver->decoder);
+        receiver->decoder = NULL;
+    }
+    return ok;
+}
+
+// The oldest start frame the thread has not opened a file for yet
+static FbsReceiveStart fbs_receive_next_start(void) {
+    furi_mutex_acquire(receiver->lock, FuriWaitForever);
+    furi_check(receiver->starts_queued != receiver->starts_taken);
+    FbsReceiveStart start = receiver->starts[receiver->starts_taken++ % FBS_RECEIVE_EVENTS];
+    furi_mutex_release(receiver->lock);
+    return start;
+}
+
+// Open the announced file at the position the protocol will resume from, then tell the
+// sender where that is
+static bool fbs_receive_open(const char* folder, FuriString* path, FbsReceiveStart* start) {
+    FileProtocolReceiver* protocol = &start->protocol;
+
+    furi_string_printf(path, "%s/", folder);
+    for(const char* c = protocol->name; *c; c++) {
+        furi_string_push_back(path, (*c == '/' || *c == '\\') ? '_' : *c);
+    }
+    if(protocol->name[0] == '\0') furi_string_cat_str(path, FBS_RECEIVE_NAME);
+    const char* file_path = furi_string_get_cstr(path);
+
+    if(protocol->offset > 0) {
+        // Continue the partial copy, unless it went missing or shrank since
+        bool resumed =
+            storage_file_open(receiver->file, file_path, FSAM_WRITE, FSOM_OPEN_EXISTING);
+        if(resumed) {
+            resumed = storage_file_size(receiver->file) >= protocol->offset &&
+                      storage_file_seek(receiver->file, protocol->offset, true) &&
+                      storage_file_truncate(receiver->file);
+            if(!resumed) storage_file_close(receiver->file);
+        }
+        if(!resumed) {
+            file_protocol_receiver_restart(protocol);
+            furi_mutex_acquire(receiver->lock, FuriWaitForever);
+            file_protocol_receiver_restart(&receiver->protocol);
+            uint32_t stale = receiver->queued;
+            furi_mutex_release(receiver->lock);
+            // Payloads queued since belong at an offset the new copy does not reach
+            fbs_receive_discard(stale);
+        }
+        receiver->open = resumed;
+    }
+    if(!receiver->open) {
+        receiver->open =
+            storage_file_open(receiver->file, file_path, FSAM_WRITE, FSOM_CREATE_ALWAYS);
+    }
+    if(!receiver->open) {
+        FURI_LOG_E(TAG, "Cannot create %s", file_path);
+        return false;
+    }
+
+    receiver->written = protocol->offset;
+    receiver->file_size = protocol->file_size;
+    receiver->decoded = 0;
+    receiver->used = 0;
+    receiver->packed_length = 0;
+    receiver->packed_pos = 0;
+    if(protocol->flags & FILE_FLAG_LZ) {
+        receiver->decoder = lz_decoder_alloc();
+    }
+
+    uint8_t reply[FILE_FRAME_HEADER_SIZE];
+    size_t size = file_protocol_build_resume(protocol, reply, sizeof(reply));
+    FURI_LOG_I(TAG, "Receiving %s from %lu", protocol->name, protocol->offset);
+    return fbs_tx(reply, size);
+}
+
+bool fbs_receive_file(
+    const char* folder,
+    FuriString* path,
+    FbsProgressCallback callback,
+    void* context) {
+    if(!svc) return false;
+    if(!receiver) {
+        receiver = malloc(sizeof(FbsReceiver));
+        memset(receiver, 0, sizeof(FbsReceiver));
+        receiver->data = furi_stream_buffer_alloc(FBS_RECEIVE_BUFFER_SIZE, 1);
+        receiver->events =
+            furi_message_queue_alloc(FBS_RECEIVE_EVENTS, sizeof(FileReceiveEvent));
+        receiver->lock = furi_mutex_alloc(FuriMutexTypeNormal);
+    }
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, folder);
+    receiver->file = storage_file_alloc(storage);
+    receiver->dropped = 0;
+    receiver->woken = false;
+    tx_retries = 0;
+    receiver->starts_queued = 0;
+    receiver->starts_taken = 0;
+    receiver->queued = 0;
+    receiver->taken = 0;
+    furi_stream_buffer_reset(receiver->data);
+    furi_message_queue_reset(receiver->events);
+    receiving = true;
+
+    bool ok = true;
+    bool done = false;
+    uint32_t start_tick = furi_get_tick();
+    uint32_t start_offset = 0;
+
+    while(ok && !done) {
+        // Keep draining without a pause while the callback is queueing data
+        uint32_t wait = furi_stream_buffer_bytes_available(receiver->data) ?
+                            0 :
+                            furi_ms_to_ticks(FBS_RECEIVE_POLL_MS);
+        FileReceiveEvent event = FileReceiveEventNone;
+        furi_message_queue_get(receiver->events, &event, wait);
+        if(event == FileReceiveEventData) receiver->woken = false;
+
+        // Payloads queued ahead of an event belong before it; those behind a start frame
+        // wait for the file it opens
+        if(receiver->open) ok = fbs_receive_drain();
+
+        switch(event) {
+        case FileReceiveEventStart: {
+            fbs_receive_close();
+            FbsReceiveStart start = fbs_receive_next_start();
+            // Nothing is left ahead of it unless no file was open to take it
+            fbs_receive_discard(start.mark);
+            ok = ok && fbs_receive_open(folder, path, &start);
+            start_tick = furi_get_tick();
+            start_offset = receiver->written;
+            break;
+        }
+        case FileReceiveEventEnd:
+            done = receiver->open;
+            // The end frame's CRC covers the compressed bytes; the file has to be whole too
+            if(done && receiver->decoder && receiver->decoded != receiver->file_size) {
+                FURI_LOG_W(
+                    TAG, "Decoded %lu of %lu bytes", receiver->decoded, receiver->file_size);
+                ok = false;
+            }
+            break;
+        case FileReceiveEventError:
+            // Keep what arrived intact; a new start frame continues from there
+            FURI_LOG_W(
+                TAG,
+                "Receive broken at %lu bytes, %lu frames dropped",
+                fbs_receive_protocol().offset,
+                receiver->dropped);
+            if(receiver->open) ok = fbs_write_flush();
+            break;
+        default:
+            break;
+        }
+
+        if(ok && callback) {
+            ok = callback(
+                receiver->written + receiver->used, fbs_receive_protocol().file_size, context);
+        }
+    }
+
+    receiving = false;
+    uint32_t elapsed_ms = furi_get_tick() - start_tick;
+    // Whatever the protocol accepted must be on the card for a later resume to match
+    if(receiver->open && !done) fbs_receive_drain();
+    ok = fbs_receive_close() && ok;
+    if(!furi_string_empty(path)) block_cache_invalidate(furi_string_get_cstr(path));
+    // A finished file is never continued
+    if(done) {
+        furi_mutex_acquire(receiver->lock, FuriWaitForever);
+        file_protocol_receiver_reset(&receiver->protocol);
+        furi_mutex_release(receiver->lock);
+    }
+    uint32_t received = receiver->written - start_offset;
+    storage_file_free(receiver->file);
+    receiver->file = NULL;
+    furi_record_close(RECORD_STORAGE);
+
+    if(elapsed_ms == 0) elapsed_ms = 1;
+    last_throughput = (uint32_t)((uint64_t)received * 1000 / elapsed_ms);
+    if(done) {
+        FURI_LOG_I(
+            TAG, "Received %lu bytes in %lu ms, %lu B/s", received, elapsed_ms, last_throughput);
+    }
+    return ok && done;
+}
+
+uint32_t fbs_get_frames(void) {
+    if(receiving) return fbs_receive_protocol().next_seq;
+    return pipeline ? pipeline->sender.seq : 0;
+}
+
+uint32_t fbs_get_throughput(void) {
+    return last_throughput;
+}
+
+uint32_t fbs_get_retries(void) {
+    return tx_retries;
 }
 
 void fbs_deinit(void) {
     if(svc) {
         ble_profile_serial_deinit(svc);
         svc = NULL;
+        furi_semaphore_free(resume_signal);
+        resume_signal = NULL;
+        furi_semaphore_free(tx_credits);
+        tx_credits = NULL;
+        free(pipeline);
+        pipeline = NULL;
+        if(receiver) {
+            furi_stream_buffer_free(receiver->data);
+            furi_message_queue_free(receiver->events);
+            furi_mutex_free(receiver->lock);
+            free(receiver);
+            receiver = NULL;
+        }
     }
 }
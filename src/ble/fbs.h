@@ -1,10 +1,51 @@
 #pragma once
 #include <furi.h>
 #include <storage/storage.h>
+#include <ble_profile_serial.h>
+#include "file_protocol.h"
 
-// Initialize serial BLE profile
+// Storage reads land straight in a frame's body, right after its header, so every frame
+// carries up to FBS_FRAME_PAYLOAD file bytes and is sent without further copies
+#define FBS_FRAME_SIZE    BLE_PROFILE_SERIAL_PACKET_SIZE_MAX
+#define FBS_FRAME_PAYLOAD (FBS_FRAME_SIZE - FILE_FRAME_HEADER_SIZE)
+// Frames allocated by fbs_init(): one is read from storage while the others are on air
+#define FBS_FRAME_POOL_SIZE 4
+
+// Received payloads queue up here while the SD card is busy, so writes never hold up the radio
+#define FBS_RECEIVE_BUFFER_SIZE 4096
+// Writes to the card are coalesced to this size and aligned to its sectors
+#define FBS_WRITE_SIZE  1024
+#define FBS_WRITE_ALIGN 512
+
+// Called after every frame with the bytes sent so far; return false to abort
+typedef bool (*FbsProgressCallback)(uint32_t sent, uint32_t total, void* context);
+
+// Initialize serial BLE profile; does nothing if it is already running
 bool fbs_init(void);
-// Send entire file pointed by 'path' over BLE serial
-bool fbs_send_file(const char* path);
+// Whether a central is connected to the serial profile
+bool fbs_is_connected(void);
+// Send entire file pointed by 'path' over BLE serial, compressed with lz_stream when
+// 'compress' is set and the receiver accepts it
+bool fbs_send_file(
+    const char* path,
+    bool compress,
+    FbsProgressCallback callback,
+    void* context);
+// Receive one file into 'folder', blocking until it has been saved, the transfer fails or
+// 'callback' returns false. The callback is also polled while waiting for the sender, with
+// the bytes written so far. On success 'path' holds the saved file.
+bool fbs_receive_file(
+    const char* folder,
+    FuriString* path,
+    FbsProgressCallback callback,
+    void* context);
+// Data frames of the transfer in progress: sent, counting those the receiver already held
+// on resume, or received intact
+uint32_t fbs_get_frames(void);
+// Throughput of the last completed transfer in bytes per second
+uint32_t fbs_get_throughput(void);
+// Frames the stack refused and that were sent again after a backoff, in the transfer in
+// progress or the last one
+uint32_t fbs_get_retries(void);
 // Deinitialize profile
 void fbs_deinit(void);
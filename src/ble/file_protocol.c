@@ -0,0 +1,265 @@
+#include "file_protocol.h"
+#include <string.h>
+
+#define TAG "FileProtocol"
+
+// Nibble-wide table for the reflected IEEE polynomial 0xEDB88320
+static const uint32_t crc32_nibble[16] = {
+    0x00000000,
+    0x1DB71064,
+    0x3B6E20C8,
+    0x26D930AC,
+    0x76DC4190,
+    0x6B6B51F4,
+    0x4DB26158,
+    0x5005713C,
+    0xEDB88320,
+    0xF00F9344,
+    0xD6D6A3E8,
+    0xCB61B38C,
+    0x9B64C2B0,
+    0x86D3D2D4,
+    0xA00AE278,
+    0xBDBDF21C,
+};
+
+uint32_t file_protocol_crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    crc = ~crc;
+    for(size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static size_t file_protocol_header(
+    uint8_t* frame,
+    FileFrameType type,
+    uint8_t flags,
+    uint32_t seq,
+    uint32_t offset,
+    uint16_t length) {
+    FileFrameHeader header = {
+        .type = type,
+        .flags = flags,
+        .length = length,
+        .seq = seq,
+        .offset = offset,
+        .crc = file_protocol_crc32(0, frame + FILE_FRAME_HEADER_SIZE, length),
+    };
+    memcpy(frame, &header, FILE_FRAME_HEADER_SIZE);
+    return FILE_FRAME_HEADER_SIZE + length;
+}
+
+bool file_protocol_parse(
+    const uint8_t* data,
+    size_t size,
+    FileFrameHeader* header,
+    const uint8_t** payload) {
+    if(size < FILE_FRAME_HEADER_SIZE) return false;
+    memcpy(header, data, FILE_FRAME_HEADER_SIZE);
+    if(size != FILE_FRAME_HEADER_SIZE + header->length) return false;
+
+    *payload = data + FILE_FRAME_HEADER_SIZE;
+    return file_protocol_crc32(0, *payload, header->length) == header->crc;
+}
+
+void file_protocol_sender_reset(FileProtocolSender* sender) {
+    memset(sender, 0, sizeof(FileProtocolSender));
+}
+
+void file_protocol_sender_resume(FileProtocolSender* sender, const FileFrameHeader* resume) {
+    // Only meaningful before the first byte was consumed
+    if(sender->offset != 0) return;
+    sender->flags = resume->flags & FILE_PROTOCOL_FLAGS_SUPPORTED;
+    if(sender->flags & FILE_FLAG_LZ) return;
+    sender->resume_offset = resume->offset;
+    sender->seq = resume->seq;
+}
+
+size_t file_protocol_build_start(
+    uint8_t* frame,
+    size_t capacity,
+    const char* name,
+    uint32_t file_size,
+    uint8_t flags) {
+    if(capacity < FILE_FRAME_HEADER_SIZE + sizeof(FileStartInfo)) return 0;
+
+    // The name is cut to whatever room the packet leaves
+    size_t name_length = strlen(name);
+    size_t name_room = capacity - FILE_FRAME_HEADER_SIZE - sizeof(FileStartInfo);
+    if(name_length > FILE_FRAME_NAME_MAX) name_length = FILE_FRAME_NAME_MAX;
+    if(name_length > name_room) name_length = name_room;
+    size_t length = sizeof(FileStartInfo) + name_length;
+
+    FileStartInfo info = {.version = FILE_PROTOCOL_VERSION, .file_size = file_size};
+    memcpy(frame + FILE_FRAME_HEADER_SIZE, &info, sizeof(info));
+    memcpy(frame + FILE_FRAME_HEADER_SIZE + sizeof(info), name, name_length);
+    return file_protocol_header(frame, FileFrameTypeStart, flags, 0, 0, (uint16_t)length);
+}
+
+size_t file_protocol_build_data(
+    FileProtocolSender* sender,
+    uint8_t* frame,
+    size_t capacity,
+    const uint8_t* data,
+    size_t size,
+    size_t* frame_size) {
+    *frame_size = 0;
+
+    if(sender->offset < sender->resume_offset) {
+        // Already on the receiver; it still counts towards the whole-file CRC
+        size_t skip = sender->resume_offset - sender->offset;
+        if(skip > size) skip = size;
+        sender->file_crc = file_protocol_crc32(sender->file_crc, data, skip);
+        sender->offset += skip;
+        return skip;
+    }
+
+    if(capacity <= FILE_FRAME_HEADER_SIZE) return 0;
+    size_t length = capacity - FILE_FRAME_HEADER_SIZE;
+    if(length > size) length = size;
+    if(length > UINT16_MAX) length = UINT16_MAX;
+
+    // Payloads read straight into the frame body need no copy; a resume skip can leave
+    // them a little further in, which only needs a short overlapping move
+    if(data != frame + FILE_FRAME_HEADER_SIZE) {
+        memmove(frame + FILE_FRAME_HEADER_SIZE, data, length);
+    }
+    *frame_size = file_protocol_header(
+        frame, FileFrameTypeData, 0, sender->seq, sender->offset, (uint16_t)length);
+
+    sender->file_crc = file_protocol_crc32(sender->file_crc, data, length);
+    sender->offset += length;
+    sender->seq++;
+    return length;
+}
+
+size_t file_protocol_build_end(const FileProtocolSender* sender, uint8_t* frame, size_t capacity) {
+    if(capacity < FILE_FRAME_HEADER_SIZE + sizeof(FileEndInfo)) return 0;
+
+    FileEndInfo info = {.chunks = sender->seq, .file_crc = sender->file_crc};
+    memcpy(frame + FILE_FRAME_HEADER_SIZE, &info, sizeof(info));
+    return file_protocol_header(
+        frame, FileFrameTypeEnd, 0, sender->seq, sender->offset, sizeof(info));
+}
+
+size_t file_protocol_build_error(uint8_t* frame, size_t capacity) {
+    if(capacity < FILE_FRAME_HEADER_SIZE) return 0;
+    return file_protocol_header(frame, FileFrameTypeError, 0, 0, 0, 0);
+}
+
+void file_protocol_receiver_reset(FileProtocolReceiver* receiver) {
+    memset(receiver, 0, sizeof(FileProtocolReceiver));
+}
+
+void file_protocol_receiver_restart(FileProtocolReceiver* receiver) {
+    receiver->next_seq = 0;
+    receiver->offset = 0;
+    receiver->file_crc = 0;
+}
+
+static FileReceiveEvent file_protocol_receive_start(
+    FileProtocolReceiver* receiver,
+    const FileFrameHeader* header,
+    const uint8_t* payload) {
+    FileStartInfo info;
+    if(header->length < sizeof(info)) return FileReceiveEventError;
+    memcpy(&info, payload, sizeof(info));
+    if(info.version != FILE_PROTOCOL_VERSION) {
+        FURI_LOG_W(TAG, "Unsupported protocol version %u", info.version);
+        return FileReceiveEventError;
+    }
+
+    char name[FILE_FRAME_NAME_MAX + 1];
+    size_t name_length = header->length - sizeof(info);
+    if(name_length > FILE_FRAME_NAME_MAX) name_length = FILE_FRAME_NAME_MAX;
+    memcpy(name, payload + sizeof(info), name_length);
+    name[name_length] = '\0';
+
+    // A partial, uncompressed copy of the same file is continued, anything else starts over
+    bool same_file = receiver->file_size == info.file_size && strcmp(receiver->name, name) == 0;
+    bool compressed = (header->flags | receiver->flags) & FILE_FLAG_LZ;
+    if(!same_file || compressed || receiver->offset > info.file_size) {
+        file_protocol_receiver_reset(receiver);
+        strlcpy(receiver->name, name, sizeof(receiver->name));
+        receiver->file_size = info.file_size;
+    }
+    receiver->flags = header->flags & FILE_PROTOCOL_FLAGS_SUPPORTED;
+    receiver->active = true;
+    return FileReceiveEventStart;
+}
+
+FileReceiveEvent file_protocol_receive(
+    FileProtocolReceiver* receiver,
+    const uint8_t* data,
+    size_t size,
+    const uint8_t** payload,
+    size_t* length) {
+    FileFrameHeader header;
+    const uint8_t* body;
+    *payload = NULL;
+    *length = 0;
+
+    if(!file_protocol_parse(data, size, &header, &body)) {
+        return receiver->active ? FileReceiveEventError : FileReceiveEventNone;
+    }
+
+    switch(header.type) {
+    case FileFrameTypeStart:
+        return file_protocol_receive_start(receiver, &header, body);
+
+    case FileFrameTypeData:
+        if(!receiver->active) return FileReceiveEventError;
+        // Frames already received are repeated after a resume; drop them quietly
+        if(header.seq < receiver->next_seq) return FileReceiveEventNone;
+        // A compressed stream has no size known up front
+        if(header.seq != receiver->next_seq || header.offset != receiver->offset ||
+           (!(receiver->flags & FILE_FLAG_LZ) &&
+            receiver->offset + header.length > receiver->file_size)) {
+            receiver->active = false;
+            return FileReceiveEventError;
+        }
+        receiver->file_crc = file_protocol_crc32(receiver->file_crc, body, header.length);
+        receiver->offset += header.length;
+        receiver->next_seq++;
+        *payload = body;
+        *length = header.length;
+        return FileReceiveEventData;
+
+    case FileFrameTypeEnd: {
+        if(!receiver->active) return FileReceiveEventError;
+        receiver->active = false;
+
+        FileEndInfo info;
+        if(header.length != sizeof(info)) return FileReceiveEventError;
+        memcpy(&info, body, sizeof(info));
+        bool size_ok = (receiver->flags & FILE_FLAG_LZ) || receiver->offset == receiver->file_size;
+        if(info.chunks != receiver->next_seq || !size_ok || info.file_crc != receiver->file_crc) {
+            FURI_LOG_W(TAG, "File check failed at %lu bytes", receiver->offset);
+            // What arrived does not add up to the sender's file, so resuming it could only
+            // fail the same way; the next start sends it all again
+            file_protocol_receiver_reset(receiver);
+            return FileReceiveEventError;
+        }
+        return FileReceiveEventEnd;
+    }
+
+    case FileFrameTypeError:
+        receiver->active = false;
+        return FileReceiveEventError;
+
+    default:
+        return FileReceiveEventNone;
+    }
+}
+
+size_t file_protocol_build_resume(
+    const FileProtocolReceiver* receiver,
+    uint8_t* frame,
+    size_t capacity) {
+    if(capacity < FILE_FRAME_HEADER_SIZE) return 0;
+    return file_protocol_header(
+        frame, FileFrameTypeResume, receiver->flags, receiver->next_seq, receiver->offset, 0);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <furi.h>
+
+// Framing shared by every BLE sender and by the receive path. All fields are little-endian.
+#define FILE_PROTOCOL_VERSION 1
+
+// Start frame flags. The receiver echoes the ones it accepts in its resume frame.
+#define FILE_FLAG_LZ (1 << 0) // Data payloads form one lz_stream; offsets count its bytes
+#define FILE_PROTOCOL_FLAGS_SUPPORTED (FILE_FLAG_LZ)
+
+typedef enum {
+    FileFrameTypeStart = 0x01,
+    FileFrameTypeEnd = 0x02,
+    FileFrameTypeData = 0x03,
+    FileFrameTypeResume = 0x04, // Receiver to sender: continue from this seq and offset
+    FileFrameTypeError = 0xFF,
+} FileFrameType;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t length; // Payload bytes following the header
+    uint32_t seq; // Data frame number, counted from the start of the file
+    uint32_t offset; // File offset of a data payload, or the resume point
+    uint32_t crc; // CRC32 of the payload
+} FileFrameHeader;
+
+#define FILE_FRAME_HEADER_SIZE sizeof(FileFrameHeader)
+#define FILE_FRAME_NAME_MAX    64
+
+// Start payload; the file name follows, without a terminator
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint32_t file_size;
+} FileStartInfo;
+
+typedef struct __attribute__((packed)) {
+    uint32_t chunks;
+    uint32_t file_crc;
+} FileEndInfo;
+
+// Running CRC32 (IEEE); start from 0 and feed the result back in for the next block
+uint32_t file_protocol_crc32(uint32_t crc, const uint8_t* data, size_t size);
+
+// Check a frame's length and payload CRC; on success 'payload' points into 'data'
+bool file_protocol_parse(
+    const uint8_t* data,
+    size_t size,
+    FileFrameHeader* header,
+    const uint8_t** payload);
+
+typedef struct {
+    uint8_t flags; // Accepted by the receiver; 0 until it answered
+    uint32_t seq;
+    uint32_t offset; // Bytes of the file consumed so far, sent or skipped
+    uint32_t resume_offset; // The receiver already holds everything below this
+    uint32_t file_crc;
+} FileProtocolSender;
+
+void file_protocol_sender_reset(FileProtocolSender* sender);
+
+// Adopt the flags and position reported in a resume frame from the receiver.
+// Compressed streams cannot be joined midway and always restart from zero.
+void file_protocol_sender_resume(FileProtocolSender* sender, const FileFrameHeader* resume);
+
+// Each builder writes one frame into 'frame' and returns its size, or 0 if it does not fit.
+// The start frame truncates 'name' to the room left in 'capacity'.
+size_t file_protocol_build_start(
+    uint8_t* frame,
+    size_t capacity,
+    const char* name,
+    uint32_t file_size,
+    uint8_t flags);
+
+// Frame the next bytes of the file. Returns how many bytes of 'data' were consumed and
+// sets 'frame_size' to 0 when they lay below the resume offset and were only checksummed.
+// 'data' may already sit inside the body of 'frame', in which case it is framed in place.
+size_t file_protocol_build_data(
+    FileProtocolSender* sender,
+    uint8_t* frame,
+    size_t capacity,
+    const uint8_t* data,
+    size_t size,
+    size_t* frame_size);
+
+size_t file_protocol_build_end(const FileProtocolSender* sender, uint8_t* frame, size_t capacity);
+size_t file_protocol_build_error(uint8_t* frame, size_t capacity);
+
+typedef enum {
+    FileReceiveEventNone, // Duplicate or irrelevant frame, nothing to do
+    FileReceiveEventStart, // Reply with file_protocol_build_resume()
+    FileReceiveEventData, // Append the payload at the receiver's previous offset
+    FileReceiveEventEnd, // Whole file received and its CRC matched
+    FileReceiveEventError, // Transfer broken; reply with a resume frame to recover
+} FileReceiveEvent;
+
+typedef struct {
+    bool active;
+    char name[FILE_FRAME_NAME_MAX + 1];
+    uint8_t flags;
+    uint32_t file_size;
+    uint32_t next_seq;
+    uint32_t offset; // Last good offset: every byte below it was received intact
+    uint32_t file_crc;
+} FileProtocolReceiver;
+
+void file_protocol_receiver_reset(FileProtocolReceiver* receiver);
+
+// Drop what was received of the current file but keep expecting it, e.g. when the partial
+// copy a resume would continue from has gone missing
+void file_protocol_receiver_restart(FileProtocolReceiver* receiver);
+
+// Feed one frame to the receiver state machine. For data events 'payload' and 'length'
+// describe the bytes to store.
+FileReceiveEvent file_protocol_receive(
+    FileProtocolReceiver* receiver,
+    const uint8_t* data,
+    size_t size,
+    const uint8_t** payload,
+    size_t* length);
+
+size_t file_protocol_build_resume(
+    const FileProtocolReceiver* receiver,
+    uint8_t* frame,
+    size_t capacity);
@@ -0,0 +1,289 @@
+#include "lz_stream.h"
+#include <string.h>
+
+#define LZ_HASH_BITS   9
+#define LZ_CHAIN_DEPTH 8
+#define LZ_GROUP_ITEMS 8
+#define LZ_GROUP_SIZE  (1 + LZ_GROUP_ITEMS * 2)
+
+#define LZ_DECODER_INPUT 64
+
+struct LzEncoder {
+    // One window of history followed by up to one window of input not yet encoded
+    uint8_t buffer[2 * LZ_WINDOW];
+    size_t fill;
+    size_t pos;
+    bool finishing;
+
+    // Hash chains hold buffer positions + 1 so that 0 means empty
+    uint16_t head[1 << LZ_HASH_BITS];
+    uint16_t prev[LZ_WINDOW];
+
+    uint8_t group[LZ_GROUP_SIZE];
+    uint8_t group_items;
+    uint8_t group_size;
+
+    // A finished group waiting for room in the caller's output
+    uint8_t ready[LZ_GROUP_SIZE];
+    uint8_t ready_size;
+    uint8_t ready_sent;
+};
+
+struct LzDecoder {
+    uint8_t window[LZ_WINDOW];
+    uint16_t window_pos;
+
+    uint8_t input[LZ_DECODER_INPUT];
+    uint8_t input_size;
+    uint8_t input_pos;
+
+    uint8_t flags;
+    uint8_t items_left;
+    bool have_high;
+    uint8_t match_high;
+    uint16_t copy_left;
+    uint16_t copy_distance;
+};
+
+LzEncoder* lz_encoder_alloc(void) {
+    LzEncoder* encoder = malloc(sizeof(LzEncoder));
+    lz_encoder_reset(encoder);
+    return encoder;
+}
+
+void lz_encoder_free(LzEncoder* encoder) {
+    furi_assert(encoder);
+    free(encoder);
+}
+
+void lz_encoder_reset(LzEncoder* encoder) {
+    furi_assert(encoder);
+    memset(encoder, 0, sizeof(LzEncoder));
+}
+
+static inline uint32_t lz_hash(const uint8_t* data) {
+    uint32_t value = (uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | data[2];
+    return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static void lz_encoder_insert(LzEncoder* encoder, size_t pos) {
+    if(pos + LZ_MATCH_MIN > encoder->fill) return;
+    uint32_t hash = lz_hash(encoder->buffer + pos);
+    encoder->prev[pos % LZ_WINDOW] = encoder->head[hash];
+    encoder->head[hash] = (uint16_t)(pos + 1);
+}
+
+// Drop the oldest window of history to make room for new input
+static void lz_encoder_slide(LzEncoder* encoder) {
+    memmove(encoder->buffer, encoder->buffer + LZ_WINDOW, encoder->fill - LZ_WINDOW);
+    encoder->fill -= LZ_WINDOW;
+    encoder->pos -= LZ_WINDOW;
+
+    for(size_t i = 0; i < COUNT_OF(encoder->head); i++) {
+        encoder->head[i] = encoder->head[i] > LZ_WINDOW ? encoder->head[i] - LZ_WINDOW : 0;
+    }
+    for(size_t i = 0; i < COUNT_OF(encoder->prev); i++) {
+        encoder->prev[i] = encoder->prev[i] > LZ_WINDOW ? encoder->prev[i] - LZ_WINDOW : 0;
+    }
+}
+
+size_t lz_encoder_sink(LzEncoder* encoder, const uint8_t* data, size_t size) {
+    furi_assert(encoder);
+    furi_assert(!encoder->finishing);
+
+    if(encoder->fill == sizeof(encoder->buffer) && encoder->pos >= LZ_WINDOW) {
+        lz_encoder_slide(encoder);
+    }
+
+    size_t room = sizeof(encoder->buffer) - encoder->fill;
+    if(size > room) size = room;
+    memcpy(encoder->buffer + encoder->fill, data, size);
+    encoder->fill += size;
+    return size;
+}
+
+static size_t lz_encoder_find(LzEncoder* encoder, size_t* distance) {
+    size_t pos = encoder->pos;
+    size_t limit = encoder->fill - pos;
+    if(limit > LZ_MATCH_MAX) limit = LZ_MATCH_MAX;
+    if(limit < LZ_MATCH_MIN) return 0;
+
+    const uint8_t* current = encoder->buffer + pos;
+    size_t best = 0;
+    size_t candidate = encoder->head[lz_hash(current)];
+
+    for(uint8_t depth = 0; depth < LZ_CHAIN_DEPTH && candidate > 0; depth++) {
+        size_t match = candidate - 1;
+        if(match >= pos || pos - match > LZ_WINDOW) break;
+
+        const uint8_t* earlier = encoder->buffer + match;
+        size_t length = 0;
+        while(length < limit && earlier[length] == current[length]) {
+            length++;
+        }
+        if(length > best) {
+            best = length;
+            *distance = pos - match;
+            if(best == limit) break;
+        }
+
+        size_t next = encoder->prev[match % LZ_WINDOW];
+        // An entry overwritten by a newer position ends the chain
+        if(next >= candidate) break;
+        candidate = next;
+    }
+
+    return best >= LZ_MATCH_MIN ? best : 0;
+}
+
+static void lz_encoder_step(LzEncoder* encoder) {
+    if(encoder->group_items == 0) {
+        encoder->group[0] = 0;
+        encoder->group_size = 1;
+    }
+
+    size_t distance = 0;
+    size_t length = lz_encoder_find(encoder, &distance);
+    if(length) {
+        uint16_t token = (uint16_t)((distance - 1) << LZ_LENGTH_BITS | (length - LZ_MATCH_MIN));
+        encoder->group[encoder->group_size++] = token >> 8;
+        encoder->group[encoder->group_size++] = token & 0xFF;
+    } else {
+        encoder->group[0] |= 1 << encoder->group_items;
+        encoder->group[encoder->group_size++] = encoder->buffer[encoder->pos];
+        length = 1;
+    }
+    encoder->group_items++;
+
+    for(size_t i = 0; i < length; i++) {
+        lz_encoder_insert(encoder, encoder->pos + i);
+    }
+    encoder->pos += length;
+}
+
+static void lz_encoder_close_group(LzEncoder* encoder) {
+    memcpy(encoder->ready, encoder->group, encoder->group_size);
+    encoder->ready_size = encoder->group_size;
+    encoder->ready_sent = 0;
+    encoder->group_items = 0;
+    encoder->group_size = 0;
+}
+
+size_t lz_encoder_poll(LzEncoder* encoder, uint8_t* out, size_t capacity) {
+    furi_assert(encoder);
+    size_t written = 0;
+
+    for(;;) {
+        size_t pending = encoder->ready_size - encoder->ready_sent;
+        if(pending > capacity - written) pending = capacity - written;
+        memcpy(out + written, encoder->ready + encoder->ready_sent, pending);
+        encoder->ready_sent += pending;
+        written += pending;
+        if(encoder->ready_sent < encoder->ready_size) break;
+
+        // Without a full lookahead a later sink could still extend the match
+        size_t available = encoder->fill - encoder->pos;
+        if(available == 0 || (!encoder->finishing && available < LZ_MATCH_MAX)) {
+            if(encoder->finishing && available == 0 && encoder->group_items > 0) {
+                lz_encoder_close_group(encoder);
+                continue;
+            }
+            break;
+        }
+
+        lz_encoder_step(encoder);
+        if(encoder->group_items == LZ_GROUP_ITEMS) lz_encoder_close_group(encoder);
+    }
+
+    return written;
+}
+
+void lz_encoder_finish(LzEncoder* encoder) {
+    furi_assert(encoder);
+    encoder->finishing = true;
+}
+
+bool lz_encoder_is_done(const LzEncoder* encoder) {
+    furi_assert(encoder);
+    return encoder->finishing && encoder->pos == encoder->fill && encoder->group_items == 0 &&
+           encoder->ready_sent == encoder->ready_size;
+}
+
+LzDecoder* lz_decoder_alloc(void) {
+    LzDecoder* decoder = malloc(sizeof(LzDecoder));
+    lz_decoder_reset(decoder);
+    return decoder;
+}
+
+void lz_decoder_free(LzDecoder* decoder) {
+    furi_assert(decoder);
+    free(decoder);
+}
+
+void lz_decoder_reset(LzDecoder* decoder) {
+    furi_assert(decoder);
+    memset(decoder, 0, sizeof(LzDecoder));
+}
+
+size_t lz_decoder_sink(LzDecoder* decoder, const uint8_t* data, size_t size) {
+    furi_assert(decoder);
+
+    if(decoder->input_pos > 0) {
+        memmove(
+            decoder->input,
+            decoder->input + decoder->input_pos,
+            decoder->input_size - decoder->input_pos);
+        decoder->input_size -= decoder->input_pos;
+        decoder->input_pos = 0;
+    }
+
+    size_t room = sizeof(decoder->input) - decoder->input_size;
+    if(size > room) size = room;
+    memcpy(decoder->input + decoder->input_size, data, size);
+    decoder->input_size += size;
+    return size;
+}
+
+static inline void lz_decoder_emit(LzDecoder* decoder, uint8_t byte, uint8_t* out) {
+    decoder->window[decoder->window_pos] = byte;
+    decoder->window_pos = (decoder->window_pos + 1) & (LZ_WINDOW - 1);
+    *out = byte;
+}
+
+size_t lz_decoder_poll(LzDecoder* decoder, uint8_t* out, size_t capacity) {
+    furi_assert(decoder);
+    size_t written = 0;
+
+    while(written < capacity) {
+        if(decoder->copy_left > 0) {
+            uint16_t from = (decoder->window_pos - decoder->copy_distance) & (LZ_WINDOW - 1);
+            lz_decoder_emit(decoder, decoder->window[from], out + written++);
+            decoder->copy_left--;
+            continue;
+        }
+
+        if(decoder->input_pos == decoder->input_size) break;
+        uint8_t byte = decoder->input[decoder->input_pos++];
+
+        if(decoder->items_left == 0) {
+            decoder->flags = byte;
+            decoder->items_left = LZ_GROUP_ITEMS;
+        } else if(decoder->flags & 1) {
+            lz_decoder_emit(decoder, byte, out + written++);
+            decoder->flags >>= 1;
+            decoder->items_left--;
+        } else if(!decoder->have_high) {
+            decoder->match_high = byte;
+            decoder->have_high = true;
+        } else {
+            uint16_t token = (uint16_t)decoder->match_high << 8 | byte;
+            decoder->copy_distance = (token >> LZ_LENGTH_BITS) + 1;
+            decoder->copy_left = (token & ((1 << LZ_LENGTH_BITS) - 1)) + LZ_MATCH_MIN;
+            decoder->have_high = false;
+            decoder->flags >>= 1;
+            decoder->items_left--;
+        }
+    }
+
+    return written;
+}
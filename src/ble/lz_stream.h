@@ -0,0 +1,38 @@
+#pragma once
+
+#include <furi.h>
+
+// LZSS with a 1 KiB window. Items come in groups of eight behind a flag byte whose bits,
+// least significant first, mark literals (1) and matches (0). A literal is one byte; a
+// match is two bytes, big-endian: 10 bits of distance - 1 and 6 bits of length - 3.
+#define LZ_WINDOW_BITS 10
+#define LZ_LENGTH_BITS 6
+#define LZ_WINDOW      (1 << LZ_WINDOW_BITS)
+#define LZ_MATCH_MIN   3
+#define LZ_MATCH_MAX   (LZ_MATCH_MIN + (1 << LZ_LENGTH_BITS) - 1)
+
+typedef struct LzEncoder LzEncoder;
+typedef struct LzDecoder LzDecoder;
+
+LzEncoder* lz_encoder_alloc(void);
+void lz_encoder_free(LzEncoder* encoder);
+void lz_encoder_reset(LzEncoder* encoder);
+
+// Take up to 'size' bytes of input; returns how many were taken. Once it takes nothing,
+// lz_encoder_poll() has to drain output first.
+size_t lz_encoder_sink(LzEncoder* encoder, const uint8_t* data, size_t size);
+
+// Write up to 'capacity' compressed bytes to 'out', returns the number written
+size_t lz_encoder_poll(LzEncoder* encoder, uint8_t* out, size_t capacity);
+
+// No more input follows; keep polling until lz_encoder_is_done()
+void lz_encoder_finish(LzEncoder* encoder);
+bool lz_encoder_is_done(const LzEncoder* encoder);
+
+LzDecoder* lz_decoder_alloc(void);
+void lz_decoder_free(LzDecoder* decoder);
+void lz_decoder_reset(LzDecoder* decoder);
+
+// Same contract as the encoder: sink input until it is refused, then poll output
+size_t lz_decoder_sink(LzDecoder* decoder, const uint8_t* data, size_t size);
+size_t lz_decoder_poll(LzDecoder* decoder, uint8_t* out, size_t capacity);
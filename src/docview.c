@@ -2,6 +2,7 @@
 #include <furi_hal.h>
 #include <furi_hal_resources.h>
 #include <gui/gui.h>
+#include <gui/elements.h>
 #include <gui/view.h>
 #include <gui/view_dispatcher.h>
 #include <gui/modules/submenu.h>
@@ -26,20 +27,50 @@
 
 #define BACKLIGHT_ON 1
 
-#define TEXT_BUFFER_SIZE 4096
-#define LINES_ON_SCREEN  6
-#define MAX_LINE_LENGTH  128
+#define LINE_NUMBER_DIGITS 10
 
 #define DOCUMENT_EXT_FILTER   "*"
 #define DOCUMENTS_FOLDER_PATH EXT_PATH("documents")
-#define BINARY_CHECK_BYTES    512
+
+#define AUTO_SCROLL_PERIOD_MS 1000
+
+#define HEX_OFFSET_DIGITS 8
+
+#define INDEXER_STACK_SIZE  2560
+#define INDEXER_BATCH_LINES 64
+#define INDEXER_REDRAW_MS   250
+
+#define SEARCH_STACK_SIZE  2048
+#define SEARCH_SLICE_BYTES 32768
 
 #define BLE_CHUNK_SIZE       512
 #define BLE_TRANSFER_TIMEOUT 30000
 
+#define BLE_STACK_SIZE         2048
+#define BLE_CONNECT_POLL_MS    100
+#define BLE_PROGRESS_PERIOD_MS 200
+
+// Build with DOCVIEW_BENCH defined to generate a benchmark corpus on start and log one
+// machine-readable "bench" line per measurement. tests/reader_bench.c measures the same
+// indexing, search, first page and redraw paths on a host.
+#ifdef DOCVIEW_BENCH
+#define BENCH_TAG        "DocviewBench"
+#define BENCH_BLOCK_SIZE 512
+
+#define Docview_bench_log(...) FURI_LOG_I(BENCH_TAG, __VA_ARGS__)
+#else
+// Still type-checked, but compiled out
+#define Docview_bench_log(...)              \
+    do {                                    \
+        if(0) FURI_LOG_I(TAG, __VA_ARGS__); \
+    } while(0)
+#endif
+
 static bool docview_navigation_submenu_callback(void* context) {
-    UNUSED(context);
-    view_dispatcher_switch_to_view(((DocviewApp*)context)->view_dispatcher, DocviewViewSubmenu);
+    DocviewApp* app = (DocviewApp*)context;
+    // Leaving the transfer popup cancels the transfer
+    docview_ble_transfer_stop(app);
+    view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewSubmenu);
     return true;
 }
 
@@ -47,223 +78,451 @@ static void docview_navigation_submenu_void_callback(void* context) {
     docview_navigation_submenu_callback(context);
 }
 
-static bool is_binary_content(const char* buffer, size_t size) {
-    if(size < 8) return false;
+static int32_t Docview_indexer_thread_callback(void* context) {
+    DocviewApp* app = (DocviewApp*)context;
+    char path[256];
+    uint32_t offset = 0;
+    bool done = false;
+    bool above = false;
+    uint32_t anchor = 0;
+
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            strlcpy(path, model->document_path, sizeof(path));
+            offset = line_index_end(model->index);
+            done = Docview_indexing_done(model);
+            above = model->index_above;
+            anchor = line_index_origin(model->index);
+        },
+        false);
 
-    int binary_count = 0;
-    int check_bytes = size < BINARY_CHECK_BYTES ? size : BINARY_CHECK_BYTES;
+    DocStream* stream = doc_stream_alloc();
+    doc_stream_set_hint(stream, BlockCacheHintSequential);
+    if(!doc_stream_open(stream, path)) {
+        done = true;
+        above = false;
+    }
 
-    for(int i = 0; i < check_bytes; i++) {
-        char c = buffer[i];
+    if(above) {
+        uint32_t starts[ABOVE_STARTS_MAX];
+        size_t count = Docview_scan_above(stream, anchor, starts);
+        with_view_model(
+            app->view_reader,
+            DocviewReaderModel * model,
+            {
+                if(Docview_index_above_done(model, anchor, starts, count)) {
+                    offset = line_index_end(model->index);
+                    done = Docview_indexing_done(model);
+                } else {
+                    // The document was reset underneath us
+                    done = true;
+                }
+            },
+            true);
+    }
 
-        if(c == '\r' || c == '\n' || c == '\t' || c == ' ') {
-            continue;
+    uint32_t size = doc_stream_size(stream);
+    uint32_t batch[INDEXER_BATCH_LINES];
+    uint32_t last_redraw = 0;
+    bool first_batch = true;
+    uint32_t start_tick = furi_get_tick();
+    uint32_t start_offset = offset;
+    uint32_t lines = 0;
+    bool complete = false;
+
+    while(!done) {
+        if(furi_thread_flags_get() & INDEXER_THREAD_FLAG_STOP) break;
+
+        uint32_t batch_start = offset;
+        size_t count = 0;
+        while(count < INDEXER_BATCH_LINES && offset < size) {
+            offset = doc_stream_next_line(stream, offset);
+            batch[count++] = offset;
         }
 
-        if(c < 32 || c > 126) {
-            binary_count++;
+        // Redraw for the first screen, then only often enough to update the header
+        uint32_t now = furi_get_tick();
+        bool redraw = first_batch || offset >= size ||
+                      now - last_redraw >= furi_ms_to_ticks(INDEXER_REDRAW_MS);
+
+        with_view_model(
+            app->view_reader,
+            DocviewReaderModel * model,
+            {
+                done = !Docview_index_batch(model, batch_start, batch, count, size, &redraw);
+                lines = model->total_lines;
+                complete = done && model->is_fully_indexed;
+            },
+            redraw);
+
+        if(redraw) {
+            last_redraw = now;
+            first_batch = false;
         }
     }
 
-    return (binary_count > (check_bytes / 10));
-}
-
-static void clean_binary_content(char* buffer, size_t size) {
-    for(size_t i = 0; i < size; i++) {
-        if((buffer[i] < 32 || buffer[i] > 126) && buffer[i] != '\r' && buffer[i] != '\n' &&
-           buffer[i] != '\t') {
-            buffer[i] = '.';
-        }
+    if(complete) {
+        Docview_bench_log(
+            "bench metric=index ms=%lu bytes=%lu lines=%lu from=%lu",
+            furi_get_tick() - start_tick,
+            size - start_offset,
+            lines,
+            start_offset);
     }
-}
 
-static bool Docview_load_document(DocviewReaderModel* model) {
-    Storage* storage = furi_record_open(RECORD_STORAGE);
-    File* file = storage_file_alloc(storage);
-    bool success = false;
+    doc_stream_free(stream);
+    return 0;
+}
 
-    if(storage_file_open(file, model->document_path, FSAM_READ, FSOM_OPEN_EXISTING)) {
-        uint16_t bytes_read = storage_file_read(file, model->text_buffer, TEXT_BUFFER_SIZE - 1);
+static void Docview_indexer_start(DocviewApp* app) {
+    furi_assert(app->indexer_thread == NULL);
 
-        if(bytes_read > 0) {
-            model->text_buffer[bytes_read] = '\0';
+    bool needed = false;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            // The hex view addresses bytes directly and never needs line offsets
+            needed = model->is_document_loaded && !model->hex_view &&
+                     (!Docview_indexing_done(model) || model->index_above);
+        },
+        false);
+    if(!needed) return;
 
-            model->is_binary = is_binary_content(model->text_buffer, bytes_read);
+    app->indexer_thread = furi_thread_alloc_ex(
+        "DocviewIndexer", INDEXER_STACK_SIZE, Docview_indexer_thread_callback, app);
+    furi_thread_start(app->indexer_thread);
+}
 
-            if(model->is_binary) {
-                clean_binary_content(model->text_buffer, bytes_read);
-            }
+static void Docview_indexer_stop(DocviewApp* app) {
+    if(!app->indexer_thread) return;
 
-            model->total_lines = 0;
-            char* line_start = model->text_buffer;
-            model->lines[model->total_lines++] = line_start;
-
-            for(char* c = model->text_buffer; *c != '\0'; c++) {
-                if(*c == '\n') {
-                    *c = '\0';
-                    if(*(c + 1) != '\0') {
-                        model->lines[model->total_lines++] = c + 1;
-                        if(model->total_lines >= TEXT_BUFFER_SIZE / 20) {
-                            break;
-                        }
-                    }
-                }
-            }
+    furi_thread_flags_set(furi_thread_get_id(app->indexer_thread), INDEXER_THREAD_FLAG_STOP);
+    furi_thread_join(app->indexer_thread);
+    furi_thread_free(app->indexer_thread);
+    app->indexer_thread = NULL;
+}
 
-            model->is_document_loaded = true;
-            success = true;
-        }
+// Where the next search starts: just past the current match, or the top of the screen
+static uint32_t Docview_search_origin(DocviewReaderModel* model) {
+    if(model->search_match != DOC_SEARCH_NONE) {
+        return model->search_backward ? model->search_match : model->search_match + 1;
     }
-
-    storage_file_close(file);
-    storage_file_free(file);
-    furi_record_close(RECORD_STORAGE);
-    return success;
+    if(model->hex_view) return model->hex_row * HEX_ROW_BYTES;
+    if(model->scroll_position < model->total_lines) {
+        return line_index_line_start(model->index, model->stream, model->scroll_position);
+    }
+    return 0;
 }
 
-static const uint8_t font_sizes[] = {2, 3};
-
-static void Docview_view_reader_draw_callback(Canvas* canvas, void* model) {
-    DocviewReaderModel* my_model = (DocviewReaderModel*)model;
+static int32_t Docview_search_thread_callback(void* context) {
+    DocviewApp* app = (DocviewApp*)context;
+    char path[256];
+    char needle[DOC_SEARCH_NEEDLE_MAX + 1];
+    bool match_case = false;
+    bool backward = false;
+    uint32_t from = 0;
 
-    if(!my_model->is_document_loaded) {
-        canvas_set_font(canvas, FontPrimary);
-        canvas_draw_str_aligned(canvas, 64, 32, AlignCenter, AlignCenter, "Loading document...");
-        return;
-    }
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            strlcpy(path, model->document_path, sizeof(path));
+            strlcpy(needle, model->search_text, sizeof(needle));
+            match_case = model->search_match_case;
+            backward = model->search_backward;
+            from = Docview_search_origin(model);
+            model->searching = true;
+        },
+        true);
 
-    uint8_t font_height;
-    canvas_set_color(canvas, ColorBlack);
+    DocStream* stream = doc_stream_alloc();
+    DocSearch* search = doc_search_alloc();
+    uint32_t match = DOC_SEARCH_NONE;
+    uint32_t scanned = 0;
+    bool stopped = false;
+
+    if(doc_stream_open(stream, path) && doc_search_set_needle(search, needle, !match_case)) {
+        uint32_t size = doc_stream_size(stream);
+        if(from > size) from = size;
+        uint32_t start_tick = furi_get_tick();
+
+        // Scan in slices so a stop request is seen quickly, wrapping around once
+        for(uint8_t pass = 0; pass < 2 && match == DOC_SEARCH_NONE && !stopped; pass++) {
+            if(backward) {
+                uint32_t pos = pass ? size : from;
+                uint32_t stop = pass ? from : 0;
+                while(pos > stop && match == DOC_SEARCH_NONE && !stopped) {
+                    uint32_t lower = stop;
+                    if(pos - stop > SEARCH_SLICE_BYTES) lower = pos - SEARCH_SLICE_BYTES;
+                    match = doc_search_backward(search, stream, pos, lower);
+                    scanned += pos - lower;
+                    pos = lower;
+                    stopped = furi_thread_flags_get() & SEARCH_THREAD_FLAG_STOP;
+                }
+            } else {
+                uint32_t pos = pass ? 0 : from;
+                uint32_t stop = pass ? from : size;
+                while(pos < stop && match == DOC_SEARCH_NONE && !stopped) {
+                    uint32_t upper = stop;
+                    if(stop - pos > SEARCH_SLICE_BYTES) upper = pos + SEARCH_SLICE_BYTES;
+                    match = doc_search_forward(search, stream, pos, upper);
+                    scanned += upper - pos;
+                    pos = upper;
+                    stopped = furi_thread_flags_get() & SEARCH_THREAD_FLAG_STOP;
+                }
+            }
+        }
 
-    switch(my_model->font_size) {
-    case 2:
-        canvas_set_font(canvas, FontSecondary);
-        font_height = 8;
-        break;
-    case 3:
-    default:
-        canvas_set_font(canvas, FontPrimary);
-        font_height = 12;
-        break;
+        uint32_t elapsed = furi_get_tick() - start_tick;
+        FURI_LOG_D(TAG, "Search took %lu ms", elapsed);
+        Docview_bench_log(
+            "bench metric=search ms=%lu bytes=%lu bps=%lu needle=%u found=%u",
+            elapsed,
+            scanned,
+            elapsed ? (uint32_t)((uint64_t)scanned * 1000 / elapsed) : scanned,
+            strlen(needle),
+            match != DOC_SEARCH_NONE);
     }
 
-    uint8_t lines_to_show = (64 - 10) / font_height;
+    doc_search_free(search);
+    doc_stream_free(stream);
 
-    canvas_set_font(canvas, FontSecondary);
+    bool above = false;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            model->searching = false;
+            if(!stopped && match != DOC_SEARCH_NONE) {
+                model->search_match = match;
+                // Re-indexing needs the indexer stopped, which only the GUI thread may do
+                above = match < line_index_origin(model->index);
+                if(above) {
+                    model->jump_pending = match;
+                } else {
+                    Docview_jump_to_offset(model, match);
+                }
+            }
+        },
+        true);
 
-    const char* filename = strrchr(my_model->document_path, '/');
-    if(filename) {
-        filename++;
-    } else {
-        filename = my_model->document_path;
+    if(above) view_dispatcher_send_custom_event(app->view_dispatcher, DocviewEventIdSearchAbove);
+
+    if(!stopped) {
+        notification_message(
+            app->notifications, match != DOC_SEARCH_NONE ? &sequence_ok : &sequence_error);
     }
+    return 0;
+}
 
-    canvas_draw_str_aligned(canvas, 0, 0, AlignLeft, AlignTop, filename);
+static void Docview_search_stop(DocviewApp* app) {
+    if(!app->search_thread) return;
 
-    char page_info[32];
-    snprintf(
-        page_info,
-        sizeof(page_info),
-        "%d/%d %s",
-        my_model->scroll_position / lines_to_show + 1,
-        (my_model->total_lines + lines_to_show - 1) / lines_to_show,
-        my_model->is_binary ? "[BIN]" : "");
+    furi_thread_flags_set(furi_thread_get_id(app->search_thread), SEARCH_THREAD_FLAG_STOP);
+    furi_thread_join(app->search_thread);
+    furi_thread_free(app->search_thread);
+    app->search_thread = NULL;
+}
 
-    canvas_draw_str_aligned(canvas, 128, 0, AlignRight, AlignTop, page_info);
+static void Docview_search_start(DocviewApp* app, bool backward) {
+    Docview_search_stop(app);
 
-    canvas_draw_line(canvas, 0, 9, 128, 9);
+    bool ready = false;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            ready = model->is_document_loaded && model->search_text[0] != '\0';
+            model->search_backward = backward;
+        },
+        false);
 
-    switch(my_model->font_size) {
-    case 2:
-        canvas_set_font(canvas, FontSecondary);
-        break;
-    case 3:
-    default:
-        canvas_set_font(canvas, FontPrimary);
-        break;
+    if(!ready) {
+        notification_message(app->notifications, &sequence_error);
+        return;
     }
 
-    int16_t y_pos = 10;
-
-    my_model->long_line_detected = false;
-
-    for(int i = 0; i < lines_to_show && (i + my_model->scroll_position) < my_model->total_lines;
-        i++) {
-        char* line = my_model->lines[i + my_model->scroll_position];
+    app->search_thread = furi_thread_alloc_ex(
+        "DocviewSearch", SEARCH_STACK_SIZE, Docview_search_thread_callback, app);
+    furi_thread_start(app->search_thread);
+}
 
-        int line_width = canvas_string_width(canvas, line);
-        if(line_width > 128) {
-            my_model->long_line_detected = true;
+// When the view comes within a page of line 0 of an index that starts partway into the
+// document, have the indexer put the lines above it in front of the index
+static void Docview_index_above(DocviewApp* app) {
+    bool needed = false;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            needed = model->is_document_loaded && !model->hex_view && !model->index_above &&
+                     model->scroll_position < Docview_lines_to_show(model) &&
+                     line_index_origin(model->index) > 0;
+            if(needed) model->index_above = true;
+        },
+        false);
+    if(!needed) return;
 
-            char visible_line[MAX_LINE_LENGTH + 1];
-            size_t line_len = strlen(line);
+    // A running indexer only looks for the request when it starts
+    Docview_indexer_stop(app);
+    Docview_indexer_start(app);
+}
 
-            size_t start_pos = 0;
-            if(my_model->h_scroll_offset < line_len) {
-                start_pos = my_model->h_scroll_offset;
-            } else {
-                if(my_model->auto_scroll) {
-                    my_model->h_scroll_offset = 0;
-                } else {
-                    my_model->h_scroll_offset = line_len > 0 ? line_len - 1 : 0;
+// Show the line holding 'offset' as soon as it is indexed. Outside the indexed range the
+// index starts over there, and the indexer splits the lines just above it first, as open at
+// end does, instead of indexing everything in between.
+static void Docview_jump_reindex(DocviewApp* app, uint32_t offset) {
+    Docview_indexer_stop(app);
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            if(model->is_document_loaded && offset < doc_stream_size(model->stream)) {
+                if(offset < line_index_origin(model->index) ||
+                   offset >= line_index_end(model->index)) {
+                    // Keep what was indexed from the top for the next time
+                    Docview_save_index(model);
+                    Docview_reset_index(model);
+                    line_index_reset_at(model->index, offset);
+                    model->index_above = true;
                 }
-                start_pos = my_model->h_scroll_offset;
+                Docview_jump_to_offset(model, offset);
+            }
+        },
+        true);
+    Docview_indexer_start(app);
+}
+
+// Look for bytes appended to the document since the last reader timer tick, index them
+// from where indexing stopped and stay on the last page
+static void Docview_follow_poll(DocviewApp* app) {
+    DocStream* stream = NULL;
+    char path[256];
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            // Appends are looked for once the indexer has reached the old end
+            if(model->is_document_loaded && model->follow &&
+               (model->is_fully_indexed || model->hex_view)) {
+                stream = model->stream;
+                strlcpy(path, model->document_path, sizeof(path));
             }
+        },
+        false);
+    // Stat and reopen on the side while draws keep reading the old handle
+    if(!stream || !doc_stream_reopen(stream)) return;
 
-            strncpy(visible_line, line + start_pos, MAX_LINE_LENGTH);
-            visible_line[MAX_LINE_LENGTH] = '\0';
+    // Saves describe the grown file from now on
+    IndexCacheKey key;
+    bool keyed = index_cache_key(path, &key);
 
-            canvas_draw_str(canvas, 0, y_pos + font_height, visible_line);
-        } else {
-            canvas_draw_str(canvas, 0, y_pos + font_height, line);
-        }
+    Docview_indexer_stop(app);
+    DocPrefetch* prefetch = NULL;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            uint32_t old_size = doc_stream_size(stream);
+            doc_stream_refresh(stream);
+            if(keyed) model->index_key = key;
+            // A last line without its terminator was still being written
+            uint8_t tail;
+            if(old_size > 0 && line_index_end(model->index) == old_size &&
+               doc_stream_read(stream, old_size - 1, &tail, 1) == 1 && tail != '\n') {
+                line_index_pop(model->index, stream);
+            }
+            model->total_lines = line_index_count(model->index);
+            model->is_fully_indexed = false;
+            text_layout_reset(model->layout);
+            reflow_reset(model->reflow);
+            Docview_scroll_to_bottom(model);
+
+            // Draws skip the prefetcher while it is swapped for one that sees the new size
+            prefetch = model->prefetch;
+            model->prefetch = NULL;
+        },
+        true);
 
-        y_pos += font_height;
+    if(prefetch) {
+        doc_prefetch_free(prefetch);
+        prefetch = doc_prefetch_alloc(path);
+        with_view_model(
+            app->view_reader, DocviewReaderModel * model, { model->prefetch = prefetch; }, false);
     }
+    Docview_indexer_start(app);
+}
 
-    if(my_model->total_lines == 0) {
-        canvas_draw_str_aligned(canvas, 64, 32, AlignCenter, AlignCenter, "Empty document");
-    }
+static const uint8_t font_sizes[] = {2, 3};
+static const char* const font_size_names[] = {"Small", "Large"};
+static const char* const on_off_names[] = {"Off", "On"};
+static const char* const view_mode_names[] = {"Text", "Hex"};
+
+// Tell the prefetcher which bytes are on screen, so the page past the edge the view is
+// moving towards is already cached when it scrolls in
+static void Docview_prefetch_view(DocviewReaderModel* model, uint32_t start, uint32_t end) {
+    if(model->prefetch) doc_prefetch_view(model->prefetch, start, end);
+}
 
-    canvas_set_font(canvas, FontSecondary);
-    if(my_model->auto_scroll) {
-        canvas_draw_str_aligned(canvas, 64, 64, AlignCenter, AlignBottom, "AUTO ⏬");
-    } else {
-        canvas_draw_str_aligned(canvas, 64, 64, AlignCenter, AlignBottom, "⬆️⬇️");
+static void Docview_view_reader_draw_callback(Canvas* canvas, void* model) {
+    DocviewReaderModel* my_model = (DocviewReaderModel*)model;
+    uint32_t start, end;
+
+#ifdef DOCVIEW_BENCH
+    uint32_t cycles = DWT->CYCCNT;
+    bool shown = Docview_draw_reader(canvas, my_model, &start, &end);
+    my_model->draw_cycles += DWT->CYCCNT - cycles;
+    my_model->draw_count++;
+
+    if(!my_model->first_page_drawn && Docview_first_page_ready(my_model)) {
+        my_model->first_page_drawn = true;
+        Docview_bench_log(
+            "bench metric=first_page ms=%lu bytes=%lu binary=%u cached=%u",
+            furi_get_tick() - my_model->open_tick,
+            doc_stream_size(my_model->stream),
+            my_model->is_binary,
+            my_model->saved_lines > 0);
     }
+#else
+    bool shown = Docview_draw_reader(canvas, my_model, &start, &end);
+#endif
+    if(shown) Docview_prefetch_view(my_model, start, end);
 }
 
 static void Docview_view_reader_timer_callback(void* context) {
     DocviewApp* app = (DocviewApp*)context;
+    bool changed = false;
+    bool follow = false;
 
     with_view_model(
         app->view_reader,
         DocviewReaderModel * model,
         {
+            DocviewViewState before = Docview_view_state(model);
             if(model->auto_scroll && model->is_document_loaded) {
-                if(model->long_line_detected) {
-                    if(model->scroll_position < model->total_lines) {
-                        char* current_line = model->lines[model->scroll_position];
-                        size_t line_len = strlen(current_line);
-
-                        model->h_scroll_offset += 2;
-
-                        if(model->h_scroll_offset > line_len) {
-                            model->h_scroll_offset = 0;
-                            if(model->scroll_position < model->total_lines - 1) {
-                                model->scroll_position++;
-                            }
-                        }
-                    }
-                } else {
-                    model->h_scroll_offset = 0;
-                    if(model->scroll_position < model->total_lines - 1) {
-                        model->scroll_position++;
-                    }
-                }
+                Docview_auto_scroll_step(model);
             }
+            changed = Docview_view_state_changed(&before, model);
+            follow = model->follow && model->is_document_loaded;
         },
-        true);
+        changed);
+
+    // Polling reopens the document, which belongs on the GUI thread with the indexer
+    if(follow) view_dispatcher_send_custom_event(app->view_dispatcher, DocviewEventIdFollow);
+}
+
+// Run the periodic timer only while auto-scroll or follow mode is on
+static void Docview_reader_timer_update(DocviewApp* app, bool run) {
+    if(!app->timer) return;
+
+    if(run) {
+        furi_timer_start(app->timer, furi_ms_to_ticks(AUTO_SCROLL_PERIOD_MS));
+    } else {
+        furi_timer_stop(app->timer);
+    }
 }
 
 static void Docview_view_reader_enter_callback(void* context) {
@@ -276,67 +535,540 @@ static void Docview_view_reader_enter_callback(void* context) {
             if(!model->is_document_loaded) {
                 Docview_load_document(model);
             }
+            if(model->is_document_loaded && !model->prefetch) {
+                model->prefetch = doc_prefetch_alloc(model->document_path);
+            }
+            if(model->is_document_loaded && model->follow) {
+                Docview_scroll_to_bottom(model);
+            }
+#ifdef DOCVIEW_BENCH
+            model->draw_tick = furi_get_tick();
+            model->draw_count = 0;
+            model->draw_cycles = 0;
+#endif
         },
         true);
 
-    uint32_t period = furi_ms_to_ticks(1000);
+    Docview_indexer_start(app);
+
+    bool run_timer = false;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        { run_timer = model->auto_scroll || model->follow; },
+        false);
+
     furi_assert(app->timer == NULL);
     app->timer =
         furi_timer_alloc(Docview_view_reader_timer_callback, FuriTimerTypePeriodic, context);
-    furi_timer_start(app->timer, period);
+    Docview_reader_timer_update(app, run_timer);
 }
 
 static void Docview_view_reader_exit_callback(void* context) {
     DocviewApp* app = (DocviewApp*)context;
 
+    // A search finishing later would re-index a reader that is no longer shown
+    Docview_search_stop(app);
+    Docview_indexer_stop(app);
+
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            if(model->prefetch) {
+                doc_prefetch_free(model->prefetch);
+                model->prefetch = NULL;
+            }
+            Docview_save_index(model);
+            FURI_LOG_D(
+                TAG, "Layout cache hit rate %u%%", text_layout_hit_rate(model->layout));
+
+#ifdef DOCVIEW_BENCH
+            uint32_t elapsed = furi_get_tick() - model->draw_tick;
+            uint32_t draws = model->draw_count;
+            uint32_t cycles_per_us = furi_hal_cortex_instructions_per_microsecond();
+            BlockCacheStats blocks;
+            block_cache_get_stats(&blocks);
+            Docview_bench_log(
+                "bench metric=redraw draws=%lu ms=%lu per_s=%lu draw_us=%lu auto=%u wrap=%u "
+                "hex=%u layout_hits=%u block_hits=%lu block_misses=%lu prefetched=%lu",
+                draws,
+                elapsed,
+                elapsed ? (uint32_t)((uint64_t)draws * 1000 / elapsed) : draws,
+                draws ? model->draw_cycles / cycles_per_us / draws : 0,
+                model->auto_scroll,
+                model->word_wrap,
+                model->hex_view,
+                text_layout_hit_rate(model->layout),
+                blocks.hits,
+                blocks.misses,
+                blocks.prefetched);
+#endif
+        },
+        false);
+
     furi_timer_stop(app->timer);
     furi_timer_free(app->timer);
     app->timer = NULL;
 }
 
+static void Docview_select_for_ble(DocviewApp* app) {
+    bool document_loaded = false;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        { document_loaded = model->is_document_loaded; },
+        false);
+
+    if(document_loaded) {
+        with_view_model(
+            app->view_reader,
+            DocviewReaderModel * model,
+            {
+                if(app->ble_state.file_path) {
+                    furi_string_free(app->ble_state.file_path);
+                }
+                app->ble_state.file_path = furi_string_alloc();
+                furi_string_set_str(app->ble_state.file_path, model->document_path);
+
+                FuriString* full_path_str = furi_string_alloc_set(model->document_path);
+                FuriString* filename_str = furi_string_alloc();
+                path_extract_filename(full_path_str, filename_str, false);
+
+                strlcpy(
+                    app->ble_state.file_name,
+                    furi_string_get_cstr(filename_str),
+                    sizeof(app->ble_state.file_name));
+
+                furi_string_free(full_path_str);
+                furi_string_free(filename_str);
+            },
+            false);
+
+        notification_message(app->notifications, &sequence_ok);
+    } else {
+        notification_message(app->notifications, &sequence_error);
+    }
+}
+
+static void Docview_font_size_changed(VariableItem* item) {
+    DocviewApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, font_size_names[index]);
+
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            model->font_size = font_sizes[index];
+            model->h_scroll_offset = 0;
+        },
+        false);
+}
+
+static void Docview_word_wrap_changed(VariableItem* item) {
+    DocviewApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, on_off_names[index]);
+
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            model->word_wrap = index;
+            model->wrap_row = 0;
+            model->h_scroll_offset = 0;
+        },
+        false);
+}
+
+static void Docview_view_mode_changed(VariableItem* item) {
+    DocviewApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, view_mode_names[index]);
+
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            model->hex_view = index;
+            model->h_scroll_offset = 0;
+        },
+        false);
+}
+
+static void Docview_open_at_end_changed(VariableItem* item) {
+    DocviewApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, on_off_names[index]);
+
+    // Reopen the document in the new mode once the reader is back
+    Docview_search_stop(app);
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            model->open_at_end = index;
+            model->is_document_loaded = false;
+            model->scroll_position = 0;
+            model->h_scroll_offset = 0;
+            model->wrap_row = 0;
+            model->hex_row = 0;
+        },
+        false);
+}
+
+static void Docview_follow_changed(VariableItem* item) {
+    DocviewApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, on_off_names[index]);
+
+    with_view_model(
+        app->view_reader, DocviewReaderModel * model, { model->follow = index; }, false);
+}
+
+static void Docview_match_case_changed(VariableItem* item) {
+    DocviewApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, on_off_names[index]);
+
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            model->search_match_case = index;
+            model->search_match = DOC_SEARCH_NONE;
+        },
+        false);
+}
+
+static void Docview_find_done(void* context) {
+    DocviewApp* app = context;
+
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            strlcpy(model->search_text, app->temp_buffer, sizeof(model->search_text));
+            model->search_match = DOC_SEARCH_NONE;
+        },
+        false);
+
+    Docview_search_start(app, false);
+    view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewReader);
+}
+
+static void Docview_find_open(DocviewApp* app) {
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        { strlcpy(app->temp_buffer, model->search_text, app->temp_buffer_size); },
+        false);
+
+    text_input_reset(app->text_input);
+    text_input_set_header_text(app->text_input, "Find");
+    text_input_set_result_callback(
+        app->text_input, Docview_find_done, app, app->temp_buffer, app->temp_buffer_size, false);
+    view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewTextInput);
+}
+
+static void Docview_goto_offset_done(void* context) {
+    DocviewApp* app = context;
+    char* end = NULL;
+    uint32_t offset = strtoul(app->temp_buffer, &end, 16);
+
+    if(end == app->temp_buffer) {
+        notification_message(app->notifications, &sequence_error);
+    } else {
+        with_view_model(
+            app->view_reader,
+            DocviewReaderModel * model,
+            {
+                model->hex_view = true;
+                model->hex_row = 0;
+                Docview_hex_scroll(model, (int32_t)(offset / HEX_ROW_BYTES));
+            },
+            false);
+    }
+
+    view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewReader);
+}
+
+static void Docview_goto_offset_open(DocviewApp* app) {
+    uint32_t offset = 0;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        { offset = model->hex_row * HEX_ROW_BYTES; },
+        false);
+
+    snprintf(app->temp_buffer, HEX_OFFSET_DIGITS + 1, "%lX", offset);
+    text_input_reset(app->text_input);
+    text_input_set_header_text(app->text_input, "Offset (hex)");
+    text_input_set_result_callback(
+        app->text_input,
+        Docview_goto_offset_done,
+        app,
+        app->temp_buffer,
+        HEX_OFFSET_DIGITS + 1,
+        false);
+    view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewTextInput);
+}
+
+static void Docview_goto_line_done(void* context) {
+    DocviewApp* app = context;
+    char* end = NULL;
+    uint32_t line = strtoul(app->temp_buffer, &end, 10);
+    bool ok = end != app->temp_buffer && line > 0;
+
+    view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewReader);
+    if(ok) {
+        with_view_model(
+            app->view_reader,
+            DocviewReaderModel * model,
+            {
+                // Line numbers are unknown above an index that starts partway in
+                ok = model->is_document_loaded && line_index_origin(model->index) == 0;
+                if(ok) Docview_jump_to_line(model, line - 1);
+            },
+            true);
+    }
+    if(!ok) notification_message(app->notifications, &sequence_error);
+}
+
+static void Docview_goto_line_open(DocviewApp* app) {
+    uint32_t line = 0;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        { line = model->scroll_position + 1; },
+        false);
+
+    snprintf(app->temp_buffer, LINE_NUMBER_DIGITS + 1, "%lu", line);
+    text_input_reset(app->text_input);
+    text_input_set_header_text(app->text_input, "Line number");
+    text_input_set_result_callback(
+        app->text_input,
+        Docview_goto_line_done,
+        app,
+        app->temp_buffer,
+        LINE_NUMBER_DIGITS + 1,
+        false);
+    view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewTextInput);
+}
+
+static void Docview_goto_percent_done(void* context) {
+    DocviewApp* app = context;
+    char* end = NULL;
+    uint32_t percent = strtoul(app->temp_buffer, &end, 10);
+
+    // The reader has to be up before the jump restarts its indexer
+    view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewReader);
+    if(end == app->temp_buffer || percent > 100) {
+        notification_message(app->notifications, &sequence_error);
+        return;
+    }
+
+    uint32_t size = 0;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        { size = model->is_document_loaded ? doc_stream_size(model->stream) : 0; },
+        false);
+    if(size == 0) return;
+
+    uint32_t offset = (uint32_t)((uint64_t)size * percent / 100);
+    Docview_jump_reindex(app, offset < size ? offset : size - 1);
+}
+
+static void Docview_goto_percent_open(DocviewApp* app) {
+    uint32_t percent = 0;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            uint32_t start = 0;
+            uint32_t end = 0;
+            uint32_t size = doc_stream_size(model->stream);
+            if(size && Docview_view_span(model, LINES_ON_SCREEN, &start, &end)) {
+                percent = (uint32_t)((uint64_t)start * 100 / size);
+            }
+        },
+        false);
+
+    snprintf(app->temp_buffer, 4, "%lu", percent);
+    text_input_reset(app->text_input);
+    text_input_set_header_text(app->text_input, "Percent (0-100)");
+    text_input_set_result_callback(
+        app->text_input, Docview_goto_percent_done, app, app->temp_buffer, 4, false);
+    view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewTextInput);
+}
+
+static void Docview_reader_options_enter_callback(void* context, uint32_t index) {
+    DocviewApp* app = context;
+
+    if(index == DocviewReaderOptionGoToOffset) {
+        Docview_goto_offset_open(app);
+    } else if(index == DocviewReaderOptionGoToLine) {
+        Docview_goto_line_open(app);
+    } else if(index == DocviewReaderOptionGoToPercent) {
+        Docview_goto_percent_open(app);
+    } else if(index == DocviewReaderOptionFind) {
+        Docview_find_open(app);
+    } else if(index == DocviewReaderOptionFindNext ||
+              index == DocviewReaderOptionFindPrevious) {
+        Docview_search_start(app, index == DocviewReaderOptionFindPrevious);
+        view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewReader);
+    } else if(index == DocviewReaderOptionSelectBle) {
+        Docview_select_for_ble(app);
+        view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewReader);
+    }
+}
+
+static uint32_t Docview_reader_options_previous_callback(void* context) {
+    UNUSED(context);
+    return DocviewViewReader;
+}
+
+static uint32_t Docview_text_input_previous_callback(void* context) {
+    UNUSED(context);
+    return DocviewViewConfigure;
+}
+
+static void Docview_reader_options_open(DocviewApp* app) {
+    uint8_t font_index = 0;
+    bool word_wrap = false;
+    bool hex_view = false;
+    bool open_at_end = false;
+    bool follow = false;
+    bool match_case = false;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            font_index = Docview_font_slot(model);
+            word_wrap = model->word_wrap;
+            hex_view = model->hex_view;
+            open_at_end = model->open_at_end;
+            follow = model->follow;
+            match_case = model->search_match_case;
+        },
+        false);
+
+    VariableItemList* list = app->variable_item_list_config;
+    variable_item_list_reset(list);
+
+    app->font_size_item = variable_item_list_add(
+        list, "Font size", COUNT_OF(font_sizes), Docview_font_size_changed, app);
+    variable_item_set_current_value_index(app->font_size_item, font_index);
+    variable_item_set_current_value_text(app->font_size_item, font_size_names[font_index]);
+
+    VariableItem* item = variable_item_list_add(
+        list, "Word wrap", COUNT_OF(on_off_names), Docview_word_wrap_changed, app);
+    variable_item_set_current_value_index(item, word_wrap);
+    variable_item_set_current_value_text(item, on_off_names[word_wrap]);
+
+    item = variable_item_list_add(
+        list, "View", COUNT_OF(view_mode_names), Docview_view_mode_changed, app);
+    variable_item_set_current_value_index(item, hex_view);
+    variable_item_set_current_value_text(item, view_mode_names[hex_view]);
+
+    item = variable_item_list_add(
+        list, "Open at end", COUNT_OF(on_off_names), Docview_open_at_end_changed, app);
+    variable_item_set_current_value_index(item, open_at_end);
+    variable_item_set_current_value_text(item, on_off_names[open_at_end]);
+
+    item = variable_item_list_add(
+        list, "Follow", COUNT_OF(on_off_names), Docview_follow_changed, app);
+    variable_item_set_current_value_index(item, follow);
+    variable_item_set_current_value_text(item, on_off_names[follow]);
+
+    variable_item_list_add(list, "Go to offset", 0, NULL, app);
+    variable_item_list_add(list, "Go to line", 0, NULL, app);
+    variable_item_list_add(list, "Go to percent", 0, NULL, app);
+    variable_item_list_add(list, "Find", 0, NULL, app);
+
+    item = variable_item_list_add(
+        list, "Match case", COUNT_OF(on_off_names), Docview_match_case_changed, app);
+    variable_item_set_current_value_index(item, match_case);
+    variable_item_set_current_value_text(item, on_off_names[match_case]);
+
+    variable_item_list_add(list, "Find next", 0, NULL, app);
+    variable_item_list_add(list, "Find previous", 0, NULL, app);
+
+    variable_item_list_add(list, "Select for BLE", 0, NULL, app);
+
+    variable_item_list_set_enter_callback(list, Docview_reader_options_enter_callback, app);
+    view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewConfigure);
+}
+
 static bool Docview_view_reader_input_callback(InputEvent* event, void* context) {
     DocviewApp* app = (DocviewApp*)context;
     furi_assert(app);
+    bool changed = false;
 
     if(event->type == InputTypeShort || event->type == InputTypeRepeat) {
         if(event->key == InputKeyUp) {
+            Docview_index_above(app);
             with_view_model(
                 app->view_reader,
                 DocviewReaderModel * model,
                 {
-                    if(model->scroll_position > 0) {
+                    DocviewViewState before = Docview_view_state(model);
+                    if(model->hex_view) {
+                        Docview_hex_scroll(model, -1);
+                    } else if(model->word_wrap) {
+                        Docview_wrap_step_up(model);
+                    } else if(model->scroll_position > 0) {
                         model->h_scroll_offset = 0;
                         model->scroll_position--;
                     }
+                    changed = Docview_view_state_changed(&before, model);
                 },
-                true);
+                changed);
             return true;
         } else if(event->key == InputKeyDown) {
             with_view_model(
                 app->view_reader,
                 DocviewReaderModel * model,
                 {
-                    if(model->scroll_position < model->total_lines - 1) {
+                    DocviewViewState before = Docview_view_state(model);
+                    if(model->hex_view) {
+                        Docview_hex_scroll(model, 1);
+                    } else if(model->word_wrap) {
+                        Docview_wrap_step_down(model);
+                    } else if(model->scroll_position + 1 < model->total_lines) {
                         model->h_scroll_offset = 0;
                         model->scroll_position++;
                     }
+                    changed = Docview_view_state_changed(&before, model);
                 },
-                true);
+                changed);
             return true;
         } else if(event->key == InputKeyLeft) {
+            Docview_index_above(app);
             with_view_model(
                 app->view_reader,
                 DocviewReaderModel * model,
                 {
-                    if(model->long_line_detected && !model->auto_scroll) {
+                    DocviewViewState before = Docview_view_state(model);
+                    if(model->hex_view) {
+                        Docview_hex_scroll(model, -HEX_ROWS_ON_SCREEN);
+                    } else if(model->word_wrap) {
+                        uint8_t rows_to_show = Docview_lines_to_show(model);
+                        for(uint8_t i = 0; i < rows_to_show; i++) {
+                            if(!Docview_wrap_step_up(model)) break;
+                        }
+                    } else if(model->long_line_detected && !model->auto_scroll) {
                         if(model->h_scroll_offset > 0) {
+                            uint32_t line_start;
                             model->h_scroll_offset -= 5;
                             if(model->h_scroll_offset >
-                               strlen(model->lines[model->scroll_position])) {
+                               Docview_line_span(model, model->scroll_position, &line_start)) {
                                 model->h_scroll_offset = 0;
                             }
                         } else {
-                            uint8_t lines_to_show = model->font_size == 2 ? 8 : 5;
+                            uint8_t lines_to_show = Docview_lines_to_show(model);
                             if(model->scroll_position >= lines_to_show) {
                                 model->scroll_position -= lines_to_show;
                             } else {
@@ -344,7 +1076,7 @@ static bool Docview_view_reader_input_callback(InputEvent* event, void* context)
                             }
                         }
                     } else {
-                        uint8_t lines_to_show = model->font_size == 2 ? 8 : 5;
+                        uint8_t lines_to_show = Docview_lines_to_show(model);
                         if(model->scroll_position >= lines_to_show) {
                             model->scroll_position -= lines_to_show;
                         } else {
@@ -352,24 +1084,33 @@ static bool Docview_view_reader_input_callback(InputEvent* event, void* context)
                         }
                         model->h_scroll_offset = 0;
                     }
+                    changed = Docview_view_state_changed(&before, model);
                 },
-                true);
+                changed);
             return true;
         } else if(event->key == InputKeyRight) {
             with_view_model(
                 app->view_reader,
                 DocviewReaderModel * model,
                 {
-                    if(model->long_line_detected && !model->auto_scroll) {
-                        char* current_line = model->lines[model->scroll_position];
-                        size_t line_len = strlen(current_line);
+                    DocviewViewState before = Docview_view_state(model);
+                    uint8_t lines_to_show = Docview_lines_to_show(model);
+                    if(model->hex_view) {
+                        Docview_hex_scroll(model, HEX_ROWS_ON_SCREEN);
+                    } else if(model->word_wrap) {
+                        for(uint8_t i = 0; i < lines_to_show; i++) {
+                            if(!Docview_wrap_step_down(model)) break;
+                        }
+                    } else if(model->long_line_detected && !model->auto_scroll) {
+                        uint32_t line_start;
+                        size_t line_len =
+                            Docview_line_span(model, model->scroll_position, &line_start);
                         size_t visible_len = MAX_LINE_LENGTH;
 
                         if(model->h_scroll_offset + visible_len < line_len) {
                             model->h_scroll_offset += 5;
                         } else {
-                            uint8_t lines_to_show = model->font_size == 2 ? 8 : 5;
-                            if(model->scroll_position < model->total_lines - 1) {
+                            if(model->scroll_position + 1 < model->total_lines) {
                                 model->h_scroll_offset = 0;
                                 model->scroll_position += lines_to_show;
                                 if(model->scroll_position >= model->total_lines) {
@@ -377,66 +1118,36 @@ static bool Docview_view_reader_input_callback(InputEvent* event, void* context)
                                 }
                             }
                         }
-                    } else {
-                        uint8_t lines_to_show = model->font_size == 2 ? 8 : 5;
+                    } else if(model->total_lines > 0) {
                         model->h_scroll_offset = 0;
                         model->scroll_position += lines_to_show;
                         if(model->scroll_position >= model->total_lines) {
                             model->scroll_position = model->total_lines - 1;
                         }
                     }
+                    changed = Docview_view_state_changed(&before, model);
                 },
-                true);
+                changed);
             return true;
         } else if(event->key == InputKeyOk) {
+            bool run_timer = false;
             with_view_model(
                 app->view_reader,
                 DocviewReaderModel * model,
                 {
+                    DocviewViewState before = Docview_view_state(model);
                     model->auto_scroll = !model->auto_scroll;
                     model->h_scroll_offset = 0;
+                    run_timer = model->auto_scroll || model->follow;
+                    changed = Docview_view_state_changed(&before, model);
                 },
-                true);
+                changed);
+            Docview_reader_timer_update(app, run_timer);
             return true;
         }
     } else if(event->type == InputTypeLong) {
         if(event->key == InputKeyOk) {
-            bool document_loaded = false;
-            with_view_model(
-                app->view_reader,
-                DocviewReaderModel * model,
-                { document_loaded = model->is_document_loaded; },
-                false);
-
-            if(document_loaded) {
-                with_view_model(
-                    app->view_reader,
-                    DocviewReaderModel * model,
-                    {
-                        if(app->ble_state.file_path) {
-                            furi_string_free(app->ble_state.file_path);
-                        }
-                        app->ble_state.file_path = furi_string_alloc();
-                        furi_string_set_str(app->ble_state.file_path, model->document_path);
-
-                        FuriString* full_path_str = furi_string_alloc_set(model->document_path);
-                        FuriString* filename_str = furi_string_alloc();
-                        path_extract_filename(full_path_str, filename_str, false);
-
-                        strlcpy(
-                            app->ble_state.file_name,
-                            furi_string_get_cstr(filename_str),
-                            sizeof(app->ble_state.file_name));
-
-                        furi_string_free(full_path_str);
-                        furi_string_free(filename_str);
-                    },
-                    false);
-
-                notification_message(app->notifications, &sequence_ok);
-            } else {
-                notification_message(app->notifications, &sequence_error);
-            }
+            Docview_reader_options_open(app);
             return true;
         }
     }
@@ -463,6 +1174,7 @@ bool docview_file_browser_callback(const char* path, void* context) {
     DocviewApp* app = context;
     if(!app || !path) return false;
 
+    Docview_search_stop(app);
     with_view_model(
         app->view_reader,
         DocviewReaderModel * model,
@@ -471,6 +1183,8 @@ bool docview_file_browser_callback(const char* path, void* context) {
             model->is_document_loaded = false;
             model->scroll_position = 0;
             model->h_scroll_offset = 0;
+            model->wrap_row = 0;
+            model->hex_row = 0;
         },
         true);
 
@@ -478,6 +1192,263 @@ bool docview_file_browser_callback(const char* path, void* context) {
     return true;
 }
 
+// Runs on the BLE worker thread
+static bool docview_ble_transfer_progress(uint32_t sent, uint32_t total, void* context) {
+    DocviewApp* app = (DocviewApp*)context;
+    BleTransferState* state = &app->ble_state;
+
+    state->bytes_sent = sent;
+    state->file_size = total;
+    // A receiver stays connected and idle until the sender's first bytes land
+    if(state->status == BleTransferStatusConnected && sent > 0) {
+        state->status = BleTransferStatusTransferring;
+    }
+    uint32_t chunks = (total + FBS_FRAME_PAYLOAD - 1) / FBS_FRAME_PAYLOAD;
+    state->total_chunks = chunks < UINT16_MAX ? chunks : UINT16_MAX;
+    uint32_t frames = fbs_get_frames();
+    state->chunks_sent = frames < UINT16_MAX ? frames : UINT16_MAX;
+
+    // Throttled so the dispatcher queue never fills up with redundant redraws
+    uint32_t now = furi_get_tick();
+    if(sent == total || now - state->progress_tick >= furi_ms_to_ticks(BLE_PROGRESS_PERIOD_MS)) {
+        state->progress_tick = now;
+        view_dispatcher_send_custom_event(app->view_dispatcher, DocviewEventIdBleProgress);
+    }
+
+    return !(furi_thread_flags_get() & BLE_THREAD_FLAG_STOP);
+}
+
+int32_t docview_ble_transfer_process_callback(void* context) {
+    DocviewApp* app = (DocviewApp*)context;
+    BleTransferState* state = &app->ble_state;
+    char path[256];
+    bool compress = false;
+
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            strlcpy(path, model->document_path, sizeof(path));
+            // Text shrinks several times over; binary data mostly does not
+            compress = !model->is_binary;
+        },
+        false);
+
+    view_dispatcher_send_custom_event(app->view_dispatcher, DocviewEventIdBleStart);
+
+    bool ok = app->bt_initialized;
+    state->status = BleTransferStatusAdvertising;
+    view_dispatcher_send_custom_event(app->view_dispatcher, DocviewEventIdBleProgress);
+
+    while(ok && !fbs_is_connected()) {
+        if(furi_thread_flags_wait(BLE_THREAD_FLAG_STOP, FuriFlagWaitAny, BLE_CONNECT_POLL_MS) ==
+           BLE_THREAD_FLAG_STOP) {
+            ok = false;
+        }
+    }
+
+    if(ok && state->receiving) {
+        state->status = BleTransferStatusConnected;
+        state->progress_tick = furi_get_tick();
+        view_dispatcher_send_custom_event(app->view_dispatcher, DocviewEventIdBleProgress);
+        ok = fbs_receive_file(
+            DOCUMENTS_FOLDER_PATH, state->file_path, docview_ble_transfer_progress, app);
+    } else if(ok) {
+        state->status = BleTransferStatusTransferring;
+        state->progress_tick = furi_get_tick();
+        view_dispatcher_send_custom_event(app->view_dispatcher, DocviewEventIdBleProgress);
+        ok = fbs_send_file(path, compress, docview_ble_transfer_progress, app);
+    }
+
+    state->status = ok ? BleTransferStatusComplete : BleTransferStatusFailed;
+    view_dispatcher_send_custom_event(
+        app->view_dispatcher, ok ? DocviewEventIdBleComplete : DocviewEventIdBleFailed);
+    return 0;
+}
+
+void docview_ble_timeout_callback(void* context) {
+    DocviewApp* app = (DocviewApp*)context;
+    FURI_LOG_W(TAG, "BLE transfer stalled, cancelling");
+    if(app->ble_state.thread) {
+        furi_thread_flags_set(furi_thread_get_id(app->ble_state.thread), BLE_THREAD_FLAG_STOP);
+    }
+}
+
+void docview_ble_transfer_update_status(DocviewApp* app) {
+    BleTransferState* state = &app->ble_state;
+
+    switch(state->status) {
+    case BleTransferStatusAdvertising:
+        snprintf(state->status_text, sizeof(state->status_text), "Waiting for connection");
+        break;
+    case BleTransferStatusConnected:
+        snprintf(state->status_text, sizeof(state->status_text), "Waiting for a file");
+        break;
+    case BleTransferStatusTransferring:
+        snprintf(
+            state->status_text,
+            sizeof(state->status_text),
+            "%lu / %lu bytes\n%lu%%",
+            state->bytes_sent,
+            state->file_size,
+            state->file_size ? (uint32_t)((uint64_t)state->bytes_sent * 100 / state->file_size) :
+                               100);
+        break;
+    case BleTransferStatusComplete:
+        snprintf(
+            state->status_text,
+            sizeof(state->status_text),
+            "%s %lu bytes\n%lu B/s, %lu retries",
+            state->receiving ? "Received" : "Sent",
+            state->bytes_sent,
+            fbs_get_throughput(),
+            fbs_get_retries());
+        break;
+    case BleTransferStatusFailed:
+        snprintf(state->status_text, sizeof(state->status_text), "Transfer failed");
+        break;
+    default:
+        state->status_text[0] = '\0';
+        break;
+    }
+
+    popup_set_header(app->popup_ble, state->file_name, 64, 2, AlignCenter, AlignTop);
+    popup_set_text(app->popup_ble, state->status_text, 64, 36, AlignCenter, AlignCenter);
+}
+
+// Show the transfer popup and run the worker for the direction set in 'receiving'
+static void docview_ble_worker_start(DocviewApp* app) {
+    BleTransferState* state = &app->ble_state;
+
+    if(!app->bt_initialized) {
+        app->bt_initialized = fbs_init();
+    }
+
+    state->status = BleTransferStatusIdle;
+    state->bytes_sent = 0;
+    state->chunks_sent = 0;
+    state->file_size = 0;
+    state->total_chunks = 0;
+    state->transfer_active = true;
+    docview_ble_transfer_update_status(app);
+    view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewBleTransfer);
+
+    state->timeout_timer =
+        furi_timer_alloc(docview_ble_timeout_callback, FuriTimerTypeOnce, app);
+    furi_timer_start(state->timeout_timer, furi_ms_to_ticks(BLE_TRANSFER_TIMEOUT));
+
+    state->thread = furi_thread_alloc_ex(
+        "DocviewBle", BLE_STACK_SIZE, docview_ble_transfer_process_callback, app);
+    furi_thread_start(state->thread);
+}
+
+void docview_ble_transfer_start(DocviewApp* app) {
+    BleTransferState* state = &app->ble_state;
+    if(state->thread) return;
+
+    bool document_loaded = false;
+    with_view_model(
+        app->view_reader,
+        DocviewReaderModel * model,
+        {
+            document_loaded = model->is_document_loaded;
+            FuriString* full_path_str = furi_string_alloc_set(model->document_path);
+            FuriString* filename_str = furi_string_alloc();
+            path_extract_filename(full_path_str, filename_str, false);
+            strlcpy(
+                state->file_name, furi_string_get_cstr(filename_str), sizeof(state->file_name));
+            furi_string_free(full_path_str);
+            furi_string_free(filename_str);
+        },
+        false);
+
+    if(!document_loaded) {
+        notification_message(app->notifications, &sequence_error);
+        return;
+    }
+
+    state->receiving = false;
+    docview_ble_worker_start(app);
+}
+
+void docview_ble_receive_start(DocviewApp* app) {
+    BleTransferState* state = &app->ble_state;
+    if(state->thread) return;
+
+    strlcpy(state->file_name, "BLE Receive", sizeof(state->file_name));
+    state->receiving = true;
+    docview_ble_worker_start(app);
+}
+
+void docview_ble_transfer_stop(DocviewApp* app) {
+    BleTransferState* state = &app->ble_state;
+
+    if(state->timeout_timer) {
+        furi_timer_stop(state->timeout_timer);
+        furi_timer_free(state->timeout_timer);
+        state->timeout_timer = NULL;
+    }
+
+    if(state->thread) {
+        furi_thread_flags_set(furi_thread_get_id(state->thread), BLE_THREAD_FLAG_STOP);
+        furi_thread_join(state->thread);
+        furi_thread_free(state->thread);
+        state->thread = NULL;
+    }
+
+    state->transfer_active = false;
+}
+
+static bool docview_custom_event_callback(void* context, uint32_t event) {
+    DocviewApp* app = (DocviewApp*)context;
+    BleTransferState* state = &app->ble_state;
+
+    if(event == DocviewEventIdSearchAbove) {
+        // Like follow ticks, a match queued when the reader was left is dropped
+        if(!app->timer) return true;
+        uint32_t match = DOC_SEARCH_NONE;
+        with_view_model(
+            app->view_reader, DocviewReaderModel * model, { match = model->jump_pending; }, false);
+        if(match != DOC_SEARCH_NONE) Docview_jump_reindex(app, match);
+        return true;
+    }
+    if(event == DocviewEventIdFollow) {
+        // Ticks still queued when the reader was left are dropped
+        if(app->timer) Docview_follow_poll(app);
+        return true;
+    }
+
+    // Events still queued from a transfer that was cancelled are dropped
+    if(!state->transfer_active) return false;
+
+    switch(event) {
+    case DocviewEventIdBleStart:
+        FURI_LOG_I(TAG, "BLE transfer of %s started", state->file_name);
+        return true;
+    case DocviewEventIdBleProgress:
+        if(state->timeout_timer && (state->status == BleTransferStatusTransferring ||
+                                    state->status == BleTransferStatusConnected)) {
+            // Any progress re-arms the stall watchdog; a connected receiver waits on the user
+            furi_timer_start(state->timeout_timer, furi_ms_to_ticks(BLE_TRANSFER_TIMEOUT));
+        }
+        docview_ble_transfer_update_status(app);
+        return true;
+    case DocviewEventIdBleComplete:
+    case DocviewEventIdBleFailed:
+        docview_ble_transfer_stop(app);
+        docview_ble_transfer_update_status(app);
+        notification_message(
+            app->notifications,
+            event == DocviewEventIdBleComplete ? &sequence_success : &sequence_error);
+        if(event == DocviewEventIdBleComplete && state->receiving) {
+            docview_file_browser_callback(furi_string_get_cstr(state->file_path), app);
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
 static void docview_submenu_callback(void* context, uint32_t index) {
     DocviewApp* app = context;
     furi_assert(app);
@@ -505,18 +1476,13 @@ static void docview_submenu_callback(void* context, uint32_t index) {
         view_dispatcher_switch_to_view(app->view_dispatcher, DocviewViewFileBrowser);
         break;
 
-    case DocviewSubmenuIndexBleAirdrop: {
-        DocviewReaderModel* model;
-        with_view_model(app->view_reader, DocviewReaderModel * m, { model = m; }, false);
-        if(!model->is_document_loaded) {
-            notification_message(app->notifications, &sequence_error);
-        } else if(!fbs_init() || !fbs_send_file(model->document_path)) {
-            notification_message(app->notifications, &sequence_error);
-        } else {
-            notification_message(app->notifications, &sequence_ok);
-        }
+    case DocviewSubmenuIndexBleAirdrop:
+        docview_ble_transfer_start(app);
+        break;
+
+    case DocviewSubmenuIndexBleReceive:
+        docview_ble_receive_start(app);
         break;
-    }
 
     case DocviewSubmenuIndexSettings:
         FURI_LOG_I(TAG, "Settings selected (Not Implemented)");
@@ -532,17 +1498,7 @@ static View* docview_reader_view_alloc(DocviewApp* app) {
     View* view = view_alloc();
     view_allocate_model(view, ViewModelTypeLocking, sizeof(DocviewReaderModel));
 
-    with_view_model(
-        view,
-        DocviewReaderModel * model,
-        {
-            model->font_size = font_sizes[0];
-            model->scroll_position = 0;
-            model->h_scroll_offset = 0;
-            model->auto_scroll = false;
-            model->is_document_loaded = false;
-        },
-        true);
+    with_view_model(view, DocviewReaderModel * model, { Docview_model_init(model); }, true);
 
     view_set_context(view, app);
     view_set_draw_callback(view, Docview_view_reader_draw_callback);
@@ -563,6 +1519,9 @@ bool docview_init_views(DocviewApp* app) {
     submenu_add_item(
         app->submenu, "BLE Airdrop", DocviewSubmenuIndexBleAirdrop, docview_submenu_callback, app);
 
+    submenu_add_item(
+        app->submenu, "BLE Receive", DocviewSubmenuIndexBleReceive, docview_submenu_callback, app);
+
     submenu_add_item(
         app->submenu, "Settings", DocviewSubmenuIndexSettings, docview_submenu_callback, app);
 
@@ -575,6 +1534,19 @@ bool docview_init_views(DocviewApp* app) {
     app->view_reader = docview_reader_view_alloc(app);
     view_dispatcher_add_view(app->view_dispatcher, DocviewViewReader, app->view_reader);
 
+    app->variable_item_list_config = variable_item_list_alloc();
+    View* options_view = variable_item_list_get_view(app->variable_item_list_config);
+    view_set_previous_callback(options_view, Docview_reader_options_previous_callback);
+    view_dispatcher_add_view(app->view_dispatcher, DocviewViewConfigure, options_view);
+
+    app->text_input = text_input_alloc();
+    app->temp_buffer_size = DOC_SEARCH_NEEDLE_MAX + 1;
+    app->temp_buffer = malloc(app->temp_buffer_size);
+    app->temp_buffer[0] = '\0';
+    View* input_view = text_input_get_view(app->text_input);
+    view_set_previous_callback(input_view, Docview_text_input_previous_callback);
+    view_dispatcher_add_view(app->view_dispatcher, DocviewViewTextInput, input_view);
+
     if(!app->file_browser) {
         if(!app->ble_state.file_path) {
             app->ble_state.file_path = furi_string_alloc_set(DOCUMENTS_FOLDER_PATH);
@@ -588,7 +1560,12 @@ bool docview_init_views(DocviewApp* app) {
             file_browser_get_view(app->file_browser));
     }
 
+    app->popup_ble = popup_alloc();
+    view_dispatcher_add_view(
+        app->view_dispatcher, DocviewViewBleTransfer, popup_get_view(app->popup_ble));
+
     view_dispatcher_set_event_callback_context(app->view_dispatcher, app);
+    view_dispatcher_set_custom_event_callback(app->view_dispatcher, docview_custom_event_callback);
 
     view_dispatcher_set_navigation_event_callback(
         app->view_dispatcher, docview_navigation_submenu_callback);
@@ -632,10 +1609,34 @@ void Docview_app_free(DocviewApp* app) {
     if(app->file_browser) {
         view_dispatcher_remove_view(app->view_dispatcher, DocviewViewFileBrowser);
     }
+    docview_ble_transfer_stop(app);
+    if(app->bt_initialized) {
+        fbs_deinit();
+    }
+
+    view_dispatcher_remove_view(app->view_dispatcher, DocviewViewBleTransfer);
+    view_dispatcher_remove_view(app->view_dispatcher, DocviewViewTextInput);
+    view_dispatcher_remove_view(app->view_dispatcher, DocviewViewConfigure);
     view_dispatcher_remove_view(app->view_dispatcher, DocviewViewReader);
     view_dispatcher_remove_view(app->view_dispatcher, DocviewViewSubmenu);
 
-    view_free(app->view_reader);
+    Docview_indexer_stop(app);
+    Docview_search_stop(app);
+    if(app->view_reader) {
+        with_view_model(
+            app->view_reader,
+            DocviewReaderModel * model,
+            {
+                if(model->prefetch) doc_prefetch_free(model->prefetch);
+                Docview_model_free(model);
+            },
+            false);
+        view_free(app->view_reader);
+    }
+    variable_item_list_free(app->variable_item_list_config);
+    text_input_free(app->text_input);
+    popup_free(app->popup_ble);
+    free(app->temp_buffer);
     submenu_free(app->submenu);
 
     view_dispatcher_free(app->view_dispatcher);
@@ -659,6 +1660,8 @@ void Docview_app_free(DocviewApp* app) {
         file_browser_free(app->file_browser);
         app->file_browser = NULL;
     }
+    // Every stream and the BLE worker are gone by now
+    block_cache_deinit();
 
     if(app->mutex) {
         furi_mutex_release(app->mutex);
@@ -668,6 +1671,61 @@ void Docview_app_free(DocviewApp* app) {
     free(app);
 }
 
+#ifdef DOCVIEW_BENCH
+typedef enum {
+    DocviewBenchCorpusText,
+    DocviewBenchCorpusLongLines,
+    DocviewBenchCorpusBinary,
+} DocviewBenchCorpus;
+
+// Write one deterministic corpus file unless it already exists, so runs stay comparable
+static void Docview_bench_corpus_file(
+    Storage* storage,
+    const char* name,
+    uint32_t size,
+    DocviewBenchCorpus kind) {
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s", DOCUMENTS_FOLDER_PATH, name);
+    if(storage_file_exists(storage, path)) return;
+
+    File* file = storage_file_alloc(storage);
+    if(storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_NEW)) {
+        uint8_t block[BENCH_BLOCK_SIZE];
+        uint32_t line_length = kind == DocviewBenchCorpusText ? 72 : 4000;
+        uint32_t seed = 0x2545F491;
+        uint32_t column = 0;
+
+        for(uint32_t written = 0; written < size; written += sizeof(block)) {
+            for(size_t i = 0; i < sizeof(block); i++) {
+                seed = seed * 1664525 + 1013904223;
+                uint8_t byte = seed >> 24;
+                if(kind != DocviewBenchCorpusBinary) {
+                    byte = (byte % 6) ? 'a' + byte % 26 : ' ';
+                    if(++column >= line_length) {
+                        byte = '\n';
+                        column = 0;
+                    }
+                }
+                block[i] = byte;
+            }
+            if(storage_file_write(file, block, sizeof(block)) != sizeof(block)) break;
+        }
+    }
+    storage_file_free(file);
+}
+
+static void Docview_bench_corpus(void) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, DOCUMENTS_FOLDER_PATH);
+    Docview_bench_corpus_file(storage, "bench_text.txt", 256 * 1024, DocviewBenchCorpusText);
+    Docview_bench_corpus_file(
+        storage, "bench_long.txt", 64 * 1024, DocviewBenchCorpusLongLines);
+    Docview_bench_corpus_file(storage, "bench_binary.bin", 64 * 1024, DocviewBenchCorpusBinary);
+    furi_record_close(RECORD_STORAGE);
+    Docview_bench_log("bench metric=corpus ready=1");
+}
+#endif
+
 int32_t main_Docview_app(void* p) {
     UNUSED(p);
     int32_t ret = 0;
@@ -690,6 +1748,11 @@ int32_t main_Docview_app(void* p) {
 
     app->notifications = furi_record_open(RECORD_NOTIFICATION);
     app->dialogs = furi_record_open(RECORD_DIALOGS);
+    block_cache_init();
+
+#ifdef DOCVIEW_BENCH
+    Docview_bench_corpus();
+#endif
 
     if(!docview_init_views(app)) {
         FURI_LOG_E(TAG, "Failed to initialize GUI views");
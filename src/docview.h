@@ -16,6 +16,8 @@
 #include <storage/storage.h>
 #include <dialogs/dialogs.h>
 
+#include "docview_reader.h"
+
 // Define our own BT types to avoid dependency on the header
 typedef enum {
     BtStatusAdvertising,
@@ -29,6 +31,7 @@ typedef void* Bt;
 typedef enum {
     DocviewSubmenuIndexOpenFile,
     DocviewSubmenuIndexBleAirdrop,
+    DocviewSubmenuIndexBleReceive,
     DocviewSubmenuIndexSettings,
     DocviewSubmenuIndexAbout,
 } DocviewSubmenuIndex;
@@ -43,12 +46,31 @@ typedef enum {
     DocviewViewBleTransfer, 
 } DocviewView;
 
+typedef enum {
+    DocviewReaderOptionFontSize,
+    DocviewReaderOptionWordWrap,
+    DocviewReaderOptionView,
+    DocviewReaderOptionOpenAtEnd,
+    DocviewReaderOptionFollow,
+    DocviewReaderOptionGoToOffset,
+    DocviewReaderOptionGoToLine,
+    DocviewReaderOptionGoToPercent,
+    DocviewReaderOptionFind,
+    DocviewReaderOptionMatchCase,
+    DocviewReaderOptionFindNext,
+    DocviewReaderOptionFindPrevious,
+    DocviewReaderOptionSelectBle,
+} DocviewReaderOption;
+
 typedef enum {
     DocviewEventIdRedrawScreen = 0,
     DocviewEventIdScroll = 1,
     DocviewEventIdBleStart = 2,
     DocviewEventIdBleComplete = 3,
     DocviewEventIdBleFailed = 4,
+    DocviewEventIdBleProgress = 5,
+    DocviewEventIdSearchAbove = 6,
+    DocviewEventIdFollow = 7,
 } DocviewEventId;
 
 typedef enum {
@@ -63,6 +85,8 @@ typedef enum {
 // Thread flags for signaling between threads
 #define BLE_THREAD_FLAG_STOP (1 << 0)
 #define BLE_THREAD_FLAG_ALL (BLE_THREAD_FLAG_STOP)
+#define INDEXER_THREAD_FLAG_STOP (1 << 0)
+#define SEARCH_THREAD_FLAG_STOP  (1 << 0)
 
 typedef struct {
     BleTransferStatus status;
@@ -75,6 +99,9 @@ typedef struct {
     FuriTimer* timeout_timer;
     FuriThread* thread;
     bool transfer_active;
+    bool receiving;           // Worker accepts a file instead of sending the document
+    uint32_t progress_tick;   // When the worker last posted a progress event
+    char status_text[48];     // Popup body, rebuilt on every status event
 } BleTransferState;
 
 typedef struct DocviewApp {
@@ -100,23 +127,11 @@ typedef struct DocviewApp {
     char* temp_buffer;               
     uint32_t temp_buffer_size;       
     FuriTimer* timer;
+    FuriThread* indexer_thread;      // Extends the line index in the background
+    FuriThread* search_thread;       // Scans the document for the search text
     FileBrowser* file_browser;
 } DocviewApp;
 
-typedef struct {
-    uint8_t font_size;             
-    int16_t scroll_position;       
-    size_t h_scroll_offset;        
-    uint16_t total_lines;          
-    bool auto_scroll;              
-    bool is_binary;                
-    char document_path[256];       
-    char text_buffer[4096];        
-    char* lines[4096 / 20];        
-    bool is_document_loaded;       
-    bool long_line_detected;       
-} DocviewReaderModel;
-
 // Application functions
 DocviewApp* Docview_app_alloc(void); 
 void Docview_app_free(DocviewApp* app);
@@ -124,6 +139,7 @@ void Docview_app_free(DocviewApp* app);
 // BLE callback functions
 void docview_ble_status_changed_callback(BtStatus status, void* context);
 void docview_ble_transfer_start(DocviewApp* app);
+void docview_ble_receive_start(DocviewApp* app);
 void docview_ble_transfer_stop(DocviewApp* app);
 void docview_ble_transfer_update_status(DocviewApp* app);
 void docview_ble_timeout_callback(void* context);
@@ -0,0 +1,776 @@
+#include "docview_reader.h"
+#include <gui/elements.h>
+#include <string.h>
+
+#include "reader/text_scan.h"
+
+// Text stops short of the scrollbar on the right edge
+#define TEXT_WIDTH 124
+
+#define BINARY_CHECK_BYTES 512
+
+#define HEX_ROW_HEIGHT 9
+
+static bool is_binary_content(const char* buffer, size_t size) {
+    if(size < 8) return false;
+
+    size_t check_bytes = size < BINARY_CHECK_BYTES ? size : BINARY_CHECK_BYTES;
+    size_t binary_count = text_scan_count_binary((const uint8_t*)buffer, check_bytes);
+
+    return (binary_count > (check_bytes / 10));
+}
+
+static void clean_binary_content(char* buffer, size_t size) {
+    text_scan_clean((uint8_t*)buffer, size);
+}
+
+void Docview_model_init(DocviewReaderModel* model) {
+    model->font_size = 2;
+    model->scroll_position = 0;
+    model->h_scroll_offset = 0;
+    model->auto_scroll = false;
+    model->is_document_loaded = false;
+    model->stream = doc_stream_alloc();
+    model->index = line_index_alloc();
+    model->layout = text_layout_alloc();
+    model->reflow = reflow_alloc();
+    model->word_wrap = false;
+    model->wrap_row = 0;
+    model->hex_view = false;
+    model->hex_row = 0;
+    model->search_text[0] = '\0';
+    model->search_match_case = false;
+    model->open_at_end = false;
+    model->follow = false;
+    model->searching = false;
+    model->search_match = DOC_SEARCH_NONE;
+    model->jump_pending = DOC_SEARCH_NONE;
+    model->line_pending = LINE_NONE;
+    Docview_reset_index(model);
+}
+
+void Docview_model_free(DocviewReaderModel* model) {
+    doc_stream_free(model->stream);
+    line_index_free(model->index);
+    text_layout_free(model->layout);
+    reflow_free(model->reflow);
+}
+
+void Docview_reset_index(DocviewReaderModel* model) {
+    line_index_reset(model->index);
+    text_layout_reset(model->layout);
+    reflow_reset(model->reflow);
+    model->total_lines = 0;
+    model->saved_lines = 0;
+    model->is_fully_indexed = false;
+    model->index_truncated = false;
+    model->index_above = false;
+    model->bottom_pending = false;
+}
+
+// Whether the index will not grow any further: it reached the end of the file, or it ran
+// out of memory on the way
+bool Docview_indexing_done(const DocviewReaderModel* model) {
+    return model->is_fully_indexed || model->index_truncated;
+}
+
+// Persist the line index if it grew since it was loaded or last saved
+void Docview_save_index(DocviewReaderModel* model) {
+    if(!model->is_document_loaded || model->total_lines <= model->saved_lines) return;
+    // A truncated index would be loaded as the whole document
+    if(model->index_truncated) return;
+    // Only an index from the top of the document can be saved
+    if(line_index_origin(model->index) > 0) return;
+    // The file changed between opening it and taking its key
+    if(model->index_key.file_size != doc_stream_size(model->stream)) return;
+
+    if(index_cache_save(
+           model->document_path, &model->index_key, model->index, model->is_fully_indexed)) {
+        model->saved_lines = model->total_lines;
+    }
+}
+
+// Return the length of 'line' without its line terminator
+uint32_t Docview_line_span(DocviewReaderModel* model, uint32_t line, uint32_t* start) {
+    *start = line_index_line_start(model->index, model->stream, line);
+    uint32_t end = line_index_line_end(model->index, model->stream, line);
+
+    uint8_t tail;
+    while(end > *start && doc_stream_read(model->stream, end - 1, &tail, 1) == 1 &&
+          (tail == '\n' || tail == '\r')) {
+        end--;
+    }
+
+    return end - *start;
+}
+
+uint8_t Docview_lines_to_show(const DocviewReaderModel* model) {
+    return (64 - 10) / (model->font_size == 2 ? 8 : 12);
+}
+
+void Docview_scroll_to_bottom(DocviewReaderModel* model) {
+    uint8_t lines_to_show = Docview_lines_to_show(model);
+    model->scroll_position =
+        model->total_lines > lines_to_show ? model->total_lines - lines_to_show : 0;
+    model->wrap_row = 0;
+    model->h_scroll_offset = 0;
+
+    uint32_t hex_rows = (doc_stream_size(model->stream) + HEX_ROW_BYTES - 1) / HEX_ROW_BYTES;
+    model->hex_row = hex_rows > HEX_ROWS_ON_SCREEN ? hex_rows - HEX_ROWS_ON_SCREEN : 0;
+}
+
+bool Docview_load_document(DocviewReaderModel* model) {
+    Docview_reset_index(model);
+    model->is_binary = false;
+#ifdef DOCVIEW_BENCH
+    model->open_tick = furi_get_tick();
+#endif
+
+    if(!doc_stream_open(model->stream, model->document_path)) {
+        return false;
+    }
+
+    if(!index_cache_key(model->document_path, &model->index_key)) {
+        memset(&model->index_key, 0, sizeof(model->index_key));
+    }
+
+    bool complete = false;
+    if(model->index_key.file_size == doc_stream_size(model->stream) &&
+       index_cache_load(model->document_path, &model->index_key, model->index, &complete)) {
+        model->total_lines = line_index_count(model->index);
+        model->saved_lines = model->total_lines;
+        model->is_fully_indexed = complete;
+    }
+
+    size_t available;
+    const uint8_t* head = doc_stream_peek(model->stream, 0, &available);
+    if(head) {
+        model->is_binary = is_binary_content((const char*)head, available);
+    }
+    model->hex_view = model->is_binary;
+    model->hex_row = 0;
+
+    if(model->open_at_end) {
+        // A complete saved index already reaches the bottom. Otherwise the indexer starts
+        // from the bottom and splits the last lines above it before the reader goes there.
+        uint32_t size = doc_stream_size(model->stream);
+        if(!model->is_fully_indexed && size > 0) {
+            Docview_reset_index(model);
+            line_index_reset_at(model->index, size);
+            model->index_above = true;
+            model->bottom_pending = true;
+        }
+        Docview_scroll_to_bottom(model);
+    }
+
+    model->search_match = DOC_SEARCH_NONE;
+    model->jump_pending = DOC_SEARCH_NONE;
+    model->line_pending = LINE_NONE;
+#ifdef DOCVIEW_BENCH
+    model->first_page_drawn = false;
+#endif
+
+    model->is_document_loaded = true;
+    return true;
+}
+
+// Bring the line holding 'offset' to the top of the screen, or leave it pending until the
+// indexer has reached it
+void Docview_jump_to_offset(DocviewReaderModel* model, uint32_t offset) {
+    model->hex_row = offset / HEX_ROW_BYTES;
+    // An offset above the first indexed line waits for Docview_jump_reindex()
+    if(offset >= line_index_origin(model->index) && offset < line_index_end(model->index)) {
+        model->scroll_position = line_index_find(model->index, model->stream, offset);
+        model->wrap_row = 0;
+        model->h_scroll_offset = 0;
+        model->jump_pending = DOC_SEARCH_NONE;
+    } else {
+        model->jump_pending = offset;
+    }
+}
+
+// Bring 'line' to the top of the screen; the checkpoint table finds its offset with one
+// short scan. A line past the indexed ones waits for the indexer.
+void Docview_jump_to_line(DocviewReaderModel* model, uint32_t line) {
+    if(line >= model->total_lines) {
+        if(!Docview_indexing_done(model)) {
+            model->line_pending = line;
+            return;
+        }
+        line = model->total_lines ? model->total_lines - 1 : 0;
+    }
+
+    model->line_pending = LINE_NONE;
+    if(line >= model->total_lines) return;
+    model->scroll_position = line;
+    model->wrap_row = 0;
+    model->h_scroll_offset = 0;
+    model->hex_row = line_index_line_start(model->index, model->stream, line) / HEX_ROW_BYTES;
+}
+
+// Split up to OPEN_AT_END_LINES lines above 'anchor' with the indexer's own stream, outside
+// the view lock. Fills 'starts' from the first of them through the end of the line holding
+// 'anchor' and returns how many there are.
+size_t Docview_scan_above(DocStream* stream, uint32_t anchor, uint32_t* starts) {
+    uint32_t offset =
+        doc_stream_prev_lines(stream, anchor, OPEN_AT_END_LINES, OPEN_AT_END_SCAN_BYTES);
+    uint32_t size = doc_stream_size(stream);
+    size_t count = 0;
+    starts[count++] = offset;
+    while(offset <= anchor && offset < size && count < ABOVE_STARTS_MAX) {
+        offset = doc_stream_next_line(stream, offset);
+        starts[count++] = offset;
+    }
+    return count;
+}
+
+// Put the lines from Docview_scan_above() in front of the index, keeping the view on the
+// same line; an empty index also gets the line holding 'anchor'. An anchor inside a line,
+// after a jump or past the scan limit, starts the index over from the first of them.
+static void Docview_apply_above(
+    DocviewReaderModel* model,
+    uint32_t anchor,
+    const uint32_t* starts,
+    size_t count) {
+    size_t above = 0;
+    while(above < count && starts[above] < anchor) {
+        above++;
+    }
+
+    if(above < count && starts[above] == anchor) {
+        bool empty = line_index_count(model->index) == 0;
+        if(!line_index_prepend(model->index, starts, above)) return;
+        if(empty) {
+            if(above + 1 < count && !line_index_push(model->index, starts[above + 1])) {
+                model->index_truncated = true;
+            }
+            model->scroll_position = 0;
+            model->wrap_row = 0;
+        } else {
+            model->scroll_position += above;
+        }
+    } else {
+        line_index_reset_at(model->index, starts[0]);
+        model->is_fully_indexed = false;
+        model->index_truncated = false;
+        for(size_t i = 1; i < count; i++) {
+            if(!line_index_push(model->index, starts[i])) {
+                model->index_truncated = true;
+                break;
+            }
+        }
+        model->scroll_position = anchor < line_index_end(model->index) ?
+                                     line_index_find(model->index, model->stream, anchor) :
+                                     0;
+        model->wrap_row = 0;
+    }
+    // Cached layouts and wrapped rows are kept by line number
+    text_layout_reset(model->layout);
+    reflow_reset(model->reflow);
+    model->total_lines = line_index_count(model->index);
+}
+
+bool Docview_index_above_done(
+    DocviewReaderModel* model,
+    uint32_t anchor,
+    const uint32_t* starts,
+    size_t count) {
+    if(!model->index_above || line_index_origin(model->index) != anchor) return false;
+
+    model->index_above = false;
+    Docview_apply_above(model, anchor, starts, count);
+    if(model->bottom_pending) {
+        Docview_scroll_to_bottom(model);
+        model->bottom_pending = false;
+    }
+    if(model->jump_pending >= line_index_origin(model->index) &&
+       model->jump_pending < line_index_end(model->index)) {
+        Docview_jump_to_offset(model, model->jump_pending);
+    }
+    return true;
+}
+
+bool Docview_index_batch(
+    DocviewReaderModel* model,
+    uint32_t batch_start,
+    const uint32_t* batch,
+    size_t count,
+    uint32_t size,
+    bool* redraw) {
+    // The document was reset underneath the indexer
+    if(line_index_end(model->index) != batch_start) return false;
+
+    bool done = false;
+    for(size_t i = 0; i < count && !done; i++) {
+        done = !line_index_push(model->index, batch[i]);
+        model->index_truncated = done;
+    }
+    model->total_lines = line_index_count(model->index);
+    if(model->follow && count > 0) {
+        Docview_scroll_to_bottom(model);
+        *redraw = true;
+    }
+    if(model->jump_pending >= line_index_origin(model->index) &&
+       model->jump_pending < line_index_end(model->index)) {
+        Docview_jump_to_offset(model, model->jump_pending);
+        *redraw = true;
+    }
+    if(done || line_index_end(model->index) >= size) {
+        // Only an index that reached the end covers the document
+        model->is_fully_indexed = line_index_end(model->index) >= size;
+        done = true;
+    }
+    // Past the last line once indexing is done, the last line is shown
+    if(model->line_pending < model->total_lines ||
+       (model->line_pending != LINE_NONE && Docview_indexing_done(model))) {
+        Docview_jump_to_line(model, model->line_pending);
+        *redraw = true;
+    }
+    return !done;
+}
+
+DocviewViewState Docview_view_state(const DocviewReaderModel* model) {
+    DocviewViewState state = {
+        .scroll_position = model->scroll_position,
+        .wrap_row = model->wrap_row,
+        .h_scroll_offset = model->h_scroll_offset,
+        .hex_row = model->hex_row,
+        .hex_view = model->hex_view,
+        .auto_scroll = model->auto_scroll,
+    };
+    return state;
+}
+
+bool Docview_view_state_changed(
+    const DocviewViewState* before,
+    const DocviewReaderModel* model) {
+    return before->scroll_position != model->scroll_position ||
+           before->wrap_row != model->wrap_row ||
+           before->h_scroll_offset != model->h_scroll_offset ||
+           before->hex_row != model->hex_row || before->hex_view != model->hex_view ||
+           before->auto_scroll != model->auto_scroll;
+}
+
+uint8_t Docview_font_slot(const DocviewReaderModel* model) {
+    return model->font_size == 2 ? 0 : 1;
+}
+
+// Wrapped rows of 'line' in the current font, or NULL before the font was first drawn
+static const ReflowLine* Docview_reflow_line(DocviewReaderModel* model, uint32_t line) {
+    uint8_t slot = Docview_font_slot(model);
+    const ReflowLine* entry = reflow_lookup(model->reflow, slot, line);
+    if(entry) return entry;
+
+    const uint8_t* advance = text_layout_advances(model->layout, slot);
+    if(!advance) return NULL;
+
+    uint32_t line_start;
+    uint32_t line_len = Docview_line_span(model, line, &line_start);
+    return reflow_wrap(
+        model->reflow,
+        slot,
+        line,
+        model->stream,
+        line_start,
+        line_len,
+        advance,
+        model->is_binary,
+        TEXT_WIDTH);
+}
+
+bool Docview_wrap_step_down(DocviewReaderModel* model) {
+    const ReflowLine* entry = Docview_reflow_line(model, model->scroll_position);
+    if(entry && model->wrap_row + 1 < entry->rows) {
+        model->wrap_row++;
+        return true;
+    }
+    if(model->scroll_position + 1 < model->total_lines) {
+        model->scroll_position++;
+        model->wrap_row = 0;
+        return true;
+    }
+    return false;
+}
+
+bool Docview_wrap_step_up(DocviewReaderModel* model) {
+    if(model->wrap_row > 0) {
+        model->wrap_row--;
+        return true;
+    }
+    if(model->scroll_position == 0) return false;
+
+    model->scroll_position--;
+    const ReflowLine* entry = Docview_reflow_line(model, model->scroll_position);
+    model->wrap_row = entry ? entry->rows - 1 : 0;
+    return true;
+}
+
+static void Docview_draw_wrapped(
+    Canvas* canvas,
+    DocviewReaderModel* model,
+    uint8_t rows_to_show,
+    uint8_t font_height) {
+    char text[MAX_LINE_LENGTH + 1];
+    uint32_t line = model->scroll_position;
+    uint8_t row = model->wrap_row;
+    uint8_t shown = 0;
+    int16_t y_pos = 10;
+
+    while(shown < rows_to_show && line < model->total_lines) {
+        const ReflowLine* entry = Docview_reflow_line(model, line);
+        if(!entry) break;
+        if(row >= entry->rows) {
+            // The line wraps into fewer rows since the font changed
+            row = entry->rows - 1;
+            model->wrap_row = row;
+        }
+
+        uint32_t line_start = line_index_line_start(model->index, model->stream, line);
+        for(; row < entry->rows && shown < rows_to_show; row++, shown++) {
+            size_t text_len = reflow_row_length(entry, row);
+            if(text_len > MAX_LINE_LENGTH) text_len = MAX_LINE_LENGTH;
+            text_len = doc_stream_read(
+                model->stream, line_start + entry->row_start[row], (uint8_t*)text, text_len);
+            if(model->is_binary) {
+                clean_binary_content(text, text_len);
+            }
+            text[text_len] = '\0';
+
+            canvas_draw_str(canvas, 0, y_pos + font_height, text);
+            y_pos += font_height;
+        }
+
+        line++;
+        row = 0;
+    }
+}
+
+// Measure and clip 'line' once; redraws reuse the cached span until the view moves
+static const TextLayoutEntry* Docview_layout_line(DocviewReaderModel* model, uint32_t line) {
+    char text[MAX_LINE_LENGTH + 1];
+    uint32_t line_start;
+    uint32_t line_len = Docview_line_span(model, line, &line_start);
+
+    size_t text_len = line_len < MAX_LINE_LENGTH ? line_len : MAX_LINE_LENGTH;
+    text_len = doc_stream_read(model->stream, line_start, (uint8_t*)text, text_len);
+    if(model->is_binary) {
+        clean_binary_content(text, text_len);
+    }
+
+    TextLayoutEntry* entry = text_layout_store(model->layout, line);
+    entry->line_length = line_len;
+    entry->is_long = line_len > MAX_LINE_LENGTH ||
+                     text_layout_width(model->layout, text, text_len) > TEXT_WIDTH;
+
+    if(entry->is_long) {
+        size_t start_pos = 0;
+        if(model->h_scroll_offset < line_len) {
+            start_pos = model->h_scroll_offset;
+        } else {
+            if(model->auto_scroll) {
+                model->h_scroll_offset = 0;
+            } else {
+                model->h_scroll_offset = line_len > 0 ? line_len - 1 : 0;
+            }
+            start_pos = model->h_scroll_offset;
+        }
+
+        entry->h_offset = start_pos;
+        if(start_pos > 0) {
+            text_len = line_len - start_pos < MAX_LINE_LENGTH ? line_len - start_pos :
+                                                                 MAX_LINE_LENGTH;
+            text_len = doc_stream_read(
+                model->stream, line_start + start_pos, (uint8_t*)text, text_len);
+            if(model->is_binary) {
+                clean_binary_content(text, text_len);
+            }
+        }
+    }
+
+    if(text_len > TEXT_LAYOUT_SPAN_MAX) text_len = TEXT_LAYOUT_SPAN_MAX;
+    entry->span_length = text_layout_clip(model->layout, text, text_len, TEXT_WIDTH);
+    memcpy(entry->span, text, entry->span_length);
+    entry->span[entry->span_length] = '\0';
+    return entry;
+}
+
+static uint32_t Docview_hex_rows(DocviewReaderModel* model) {
+    return (doc_stream_size(model->stream) + HEX_ROW_BYTES - 1) / HEX_ROW_BYTES;
+}
+
+// Move the hex view by 'delta' rows, stopping at the first and last row
+void Docview_hex_scroll(DocviewReaderModel* model, int32_t delta) {
+    uint32_t rows = Docview_hex_rows(model);
+    if(delta < 0) {
+        uint32_t back = (uint32_t)-delta;
+        model->hex_row = model->hex_row > back ? model->hex_row - back : 0;
+    } else {
+        model->hex_row += (uint32_t)delta;
+    }
+    if(rows == 0) {
+        model->hex_row = 0;
+    } else if(model->hex_row >= rows) {
+        model->hex_row = rows - 1;
+    }
+}
+
+void Docview_auto_scroll_step(DocviewReaderModel* model) {
+    if(model->hex_view) {
+        Docview_hex_scroll(model, 1);
+    } else if(model->word_wrap) {
+        Docview_wrap_step_down(model);
+    } else if(model->long_line_detected) {
+        if(model->scroll_position < model->total_lines) {
+            uint32_t line_start;
+            size_t line_len = Docview_line_span(model, model->scroll_position, &line_start);
+
+            model->h_scroll_offset += 2;
+
+            if(model->h_scroll_offset > line_len) {
+                model->h_scroll_offset = 0;
+                if(model->scroll_position + 1 < model->total_lines) {
+                    model->scroll_position++;
+                }
+            }
+        }
+    } else {
+        model->h_scroll_offset = 0;
+        if(model->scroll_position + 1 < model->total_lines) {
+            model->scroll_position++;
+        }
+    }
+}
+
+// Format the visible rows straight from the page window; nothing outside it is kept
+static void Docview_draw_hex(Canvas* canvas, DocviewReaderModel* model) {
+    canvas_set_font(canvas, FontKeyboard);
+
+    uint32_t rows = Docview_hex_rows(model);
+    int16_t y_pos = 10;
+
+    for(uint32_t i = 0; i < HEX_ROWS_ON_SCREEN && model->hex_row + i < rows; i++) {
+        uint32_t offset = (model->hex_row + i) * HEX_ROW_BYTES;
+        uint8_t bytes[HEX_ROW_BYTES];
+        size_t count = doc_stream_read(model->stream, offset, bytes, HEX_ROW_BYTES);
+
+        char hex[HEX_ROW_BYTES * 2 + 2];
+        char ascii[HEX_ROW_BYTES + 1];
+        char* out = hex;
+        for(size_t b = 0; b < HEX_ROW_BYTES; b++) {
+            if(b == HEX_ROW_BYTES / 2) *out++ = ' ';
+            if(b < count) {
+                snprintf(out, 3, "%02X", bytes[b]);
+            } else {
+                out[0] = ' ';
+                out[1] = ' ';
+            }
+            out += 2;
+            if(b >= count) {
+                ascii[b] = ' ';
+            } else {
+                ascii[b] = bytes[b] >= 32 && bytes[b] <= 126 ? (char)bytes[b] : '.';
+            }
+        }
+        *out = '\0';
+        ascii[HEX_ROW_BYTES] = '\0';
+
+        char row[32];
+        snprintf(row, sizeof(row), "%06lX %s %s", offset, hex, ascii);
+        canvas_draw_str(canvas, 0, y_pos + HEX_ROW_HEIGHT, row);
+        y_pos += HEX_ROW_HEIGHT;
+    }
+
+    if(rows == 0) {
+        canvas_draw_str_aligned(canvas, 64, 32, AlignCenter, AlignCenter, "Empty document");
+    }
+}
+
+static void Docview_draw_footer(Canvas* canvas, DocviewReaderModel* model) {
+    canvas_set_font(canvas, FontSecondary);
+    if(model->searching) {
+        canvas_draw_str_aligned(canvas, 64, 64, AlignCenter, AlignBottom, "Searching...");
+    } else if(model->auto_scroll) {
+        canvas_draw_str_aligned(canvas, 64, 64, AlignCenter, AlignBottom, "AUTO ⏬");
+    } else {
+        canvas_draw_str_aligned(canvas, 64, 64, AlignCenter, AlignBottom, "⬆️⬇️");
+    }
+}
+
+// Bytes [start, end) the screen is drawn from, taken from the checkpoint table
+bool Docview_view_span(
+    DocviewReaderModel* model,
+    uint8_t lines_to_show,
+    uint32_t* start,
+    uint32_t* end) {
+    if(model->hex_view) {
+        *start = model->hex_row * HEX_ROW_BYTES;
+        *end = *start + HEX_ROWS_ON_SCREEN * HEX_ROW_BYTES;
+        return true;
+    }
+    if(model->scroll_position >= model->total_lines) return false;
+
+    uint32_t last = model->scroll_position + lines_to_show - 1;
+    if(last >= model->total_lines) last = model->total_lines - 1;
+    *start = line_index_line_start(model->index, model->stream, model->scroll_position);
+    *end = line_index_line_end(model->index, model->stream, last);
+    return true;
+}
+
+// The thumb's size and position are the share of the document's bytes on screen and above
+// it, so the bar stays proportional before indexing finishes or from an index origin
+static void Docview_draw_scrollbar(
+    Canvas* canvas,
+    DocviewReaderModel* model,
+    uint32_t start,
+    uint32_t end) {
+    uint32_t size = doc_stream_size(model->stream);
+    uint32_t shown = end > start ? end - start : 1;
+    if(shown >= size) return;
+
+    elements_scrollbar_pos(canvas, 128, 10, 64 - 10, start / shown, (size + shown - 1) / shown);
+}
+
+bool Docview_draw_reader(
+    Canvas* canvas,
+    DocviewReaderModel* my_model,
+    uint32_t* start,
+    uint32_t* end) {
+    if(!my_model->is_document_loaded) {
+        canvas_set_font(canvas, FontPrimary);
+        canvas_draw_str_aligned(canvas, 64, 32, AlignCenter, AlignCenter, "Loading document...");
+        return false;
+    }
+
+    uint8_t font_height;
+    canvas_set_color(canvas, ColorBlack);
+
+    switch(my_model->font_size) {
+    case 2:
+        canvas_set_font(canvas, FontSecondary);
+        font_height = 8;
+        break;
+    case 3:
+    default:
+        canvas_set_font(canvas, FontPrimary);
+        font_height = 12;
+        break;
+    }
+
+    uint8_t lines_to_show = (64 - 10) / font_height;
+
+    canvas_set_font(canvas, FontSecondary);
+
+    const char* filename = strrchr(my_model->document_path, '/');
+    if(filename) {
+        filename++;
+    } else {
+        filename = my_model->document_path;
+    }
+
+    canvas_draw_str_aligned(canvas, 0, 0, AlignLeft, AlignTop, filename);
+
+    char page_info[32];
+    if(my_model->hex_view) {
+        uint32_t size = doc_stream_size(my_model->stream);
+        uint32_t offset = my_model->hex_row * HEX_ROW_BYTES;
+        snprintf(
+            page_info,
+            sizeof(page_info),
+            "%lu%% [HEX]",
+            size ? (uint32_t)((uint64_t)offset * 100 / size) : 100);
+    } else if(line_index_origin(my_model->index) > 0) {
+        // Line numbers are unknown above an index that starts partway in
+        uint32_t size = doc_stream_size(my_model->stream);
+        uint32_t offset = line_index_origin(my_model->index);
+        if(my_model->scroll_position < my_model->total_lines) {
+            offset = line_index_line_start(
+                my_model->index, my_model->stream, my_model->scroll_position);
+        }
+        snprintf(
+            page_info,
+            sizeof(page_info),
+            "%lu%% %s",
+            size ? (uint32_t)((uint64_t)offset * 100 / size) : 100,
+            my_model->is_binary ? "[BIN]" : "");
+    } else {
+        snprintf(
+            page_info,
+            sizeof(page_info),
+            "%lu/%s%lu%s %s",
+            my_model->scroll_position / lines_to_show + 1,
+            my_model->is_fully_indexed ? "" : ">=",
+            (my_model->total_lines + lines_to_show - 1) / lines_to_show,
+            my_model->index_truncated ? "!" : "",
+            my_model->is_binary ? "[BIN]" : "");
+    }
+
+    canvas_draw_str_aligned(canvas, 128, 0, AlignRight, AlignTop, page_info);
+
+    canvas_draw_line(canvas, 0, 9, 128, 9);
+
+    if(my_model->hex_view) {
+        Docview_draw_hex(canvas, my_model);
+        Docview_draw_footer(canvas, my_model);
+        return Docview_view_span(my_model, HEX_ROWS_ON_SCREEN, start, end);
+    }
+
+    switch(my_model->font_size) {
+    case 2:
+        text_layout_set_font(my_model->layout, canvas, 0, FontSecondary);
+        break;
+    case 3:
+    default:
+        text_layout_set_font(my_model->layout, canvas, 1, FontPrimary);
+        break;
+    }
+
+    int16_t y_pos = 10;
+
+    my_model->long_line_detected = false;
+
+    if(my_model->word_wrap) {
+        Docview_draw_wrapped(canvas, my_model, lines_to_show, font_height);
+    }
+
+    for(int i = 0; !my_model->word_wrap && i < lines_to_show &&
+                   (i + my_model->scroll_position) < my_model->total_lines;
+        i++) {
+        uint32_t line = i + my_model->scroll_position;
+        const TextLayoutEntry* entry =
+            text_layout_lookup(my_model->layout, line, my_model->h_scroll_offset);
+        if(!entry) {
+            entry = Docview_layout_line(my_model, line);
+        }
+
+        if(entry->is_long) {
+            my_model->long_line_detected = true;
+        }
+
+        canvas_draw_str(canvas, 0, y_pos + font_height, entry->span);
+
+        y_pos += font_height;
+    }
+
+    if(my_model->total_lines == 0) {
+        canvas_draw_str_aligned(
+            canvas,
+            64,
+            32,
+            AlignCenter,
+            AlignCenter,
+            my_model->index_truncated  ? "Out of memory" :
+            my_model->is_fully_indexed ? "Empty document" :
+                                         "Indexing...");
+    }
+
+    Docview_draw_footer(canvas, my_model);
+    if(!Docview_view_span(my_model, lines_to_show, start, end)) return false;
+    Docview_draw_scrollbar(canvas, my_model, *start, *end);
+    return true;
+}
+
+bool Docview_first_page_ready(const DocviewReaderModel* model) {
+    return model->is_document_loaded &&
+           (model->hex_view || Docview_indexing_done(model) ||
+            model->total_lines >= LINES_ON_SCREEN);
+}
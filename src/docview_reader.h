@@ -0,0 +1,145 @@
+#pragma once
+
+// The reader's document model and everything done with it that does not need the app:
+// opening a document, applying what the indexer found, moving the view and drawing it.
+// Callers hold the view model lock; tests/reader_bench.c drives it on a host canvas.
+
+#include <furi.h>
+#include <gui/canvas.h>
+
+#include "reader/doc_stream.h"
+#include "reader/line_index.h"
+#include "reader/index_cache.h"
+#include "reader/text_layout.h"
+#include "reader/reflow.h"
+#include "reader/doc_search.h"
+#include "reader/doc_prefetch.h"
+
+#define LINES_ON_SCREEN 6
+#define MAX_LINE_LENGTH 128
+
+#define LINE_NONE UINT32_MAX
+
+#define HEX_ROW_BYTES      4
+#define HEX_ROWS_ON_SCREEN 5
+
+// Open at end indexes this many lines above the bottom, and as many more each time the view
+// moves above them, scanning back no further than the byte limit
+#define OPEN_AT_END_LINES      64
+#define OPEN_AT_END_SCAN_BYTES 8192
+// Line starts such a scan can produce: lines longer than DOC_STREAM_LINE_MAX come in pieces,
+// and the lines reaching and holding the anchor are split too
+#define ABOVE_STARTS_MAX (OPEN_AT_END_LINES + OPEN_AT_END_SCAN_BYTES / DOC_STREAM_LINE_MAX + 3)
+
+typedef struct {
+    uint8_t font_size;             
+    uint32_t scroll_position;      
+    size_t h_scroll_offset;        
+    uint32_t total_lines;          
+    bool auto_scroll;              
+    bool is_binary;                
+    char document_path[256];       
+    DocStream* stream;             // Paged window over the open document
+    DocPrefetch* prefetch;         // Reads ahead of the view while the reader is shown
+    LineIndex* index;              // Line offsets discovered so far
+    uint32_t saved_lines;          // Lines already persisted in the index sidecar
+    IndexCacheKey index_key;       // Size and timestamp of the file the index describes
+    TextLayout* layout;            // Glyph widths and clipped spans of visible lines
+    Reflow* reflow;                // Wrapped rows of visible lines, per font
+    bool word_wrap;                
+    uint8_t wrap_row;              // First visual row of scroll_position when wrapping
+    bool hex_view;                 // Show offsets and raw bytes instead of lines
+    uint32_t hex_row;              // First hex row on screen
+    char search_text[DOC_SEARCH_NEEDLE_MAX + 1];
+    bool search_match_case;        
+    bool search_backward;          
+    bool searching;                
+    uint32_t search_match;         // Offset of the current match, or DOC_SEARCH_NONE
+    uint32_t jump_pending;         // Offset waiting for the indexer to reach it
+    uint32_t line_pending;         // Line waiting for the indexer to reach it
+    bool index_above;              // Lines above line 0 wait for the indexer to split them
+    bool bottom_pending;           // Go to the last page once the indexer has put it in front
+    bool is_fully_indexed;         
+    bool index_truncated;          // Out of memory for line offsets; lines past it are not shown
+    bool open_at_end;              // Load documents at their last page, indexing only the tail
+    bool follow;                   // Index appends on every timer tick and stay at the bottom
+    bool is_document_loaded;       
+    bool long_line_detected;       
+#ifdef DOCVIEW_BENCH
+    uint32_t open_tick;            // When the document was opened, for benchmark lines
+    bool first_page_drawn;         
+    uint32_t draw_tick;            // When the reader was entered
+    uint32_t draw_count;           // Redraws since draw_tick
+    uint32_t draw_cycles;          // CPU cycles spent in those redraws
+#endif
+} DocviewReaderModel;
+
+// The parts of the model that decide what the reader draws
+typedef struct {
+    uint32_t scroll_position;
+    uint8_t wrap_row;
+    size_t h_scroll_offset;
+    uint32_t hex_row;
+    bool hex_view;
+    bool auto_scroll;
+} DocviewViewState;
+
+DocviewViewState Docview_view_state(const DocviewReaderModel* model);
+bool Docview_view_state_changed(const DocviewViewState* before, const DocviewReaderModel* model);
+
+// Allocate the stream, index and caches of a model in the small font, with nothing loaded.
+// The prefetcher is left to the caller.
+void Docview_model_init(DocviewReaderModel* model);
+void Docview_model_free(DocviewReaderModel* model);
+
+// Open model->document_path, restore its saved index and set up open at end
+bool Docview_load_document(DocviewReaderModel* model);
+void Docview_reset_index(DocviewReaderModel* model);
+bool Docview_indexing_done(const DocviewReaderModel* model);
+void Docview_save_index(DocviewReaderModel* model);
+
+// Split the lines above 'anchor' on the indexer's stream, without the model
+size_t Docview_scan_above(DocStream* stream, uint32_t anchor, uint32_t* starts);
+// Apply a Docview_scan_above() that started from line 0 at 'anchor'. False if the index was
+// reset since.
+bool Docview_index_above_done(
+    DocviewReaderModel* model,
+    uint32_t anchor,
+    const uint32_t* starts,
+    size_t count);
+// Append lines the indexer split from 'batch_start' up to 'size' and follow the view along.
+// Sets 'redraw' when the view moved; false once indexing is over.
+bool Docview_index_batch(
+    DocviewReaderModel* model,
+    uint32_t batch_start,
+    const uint32_t* batch,
+    size_t count,
+    uint32_t size,
+    bool* redraw);
+
+uint32_t Docview_line_span(DocviewReaderModel* model, uint32_t line, uint32_t* start);
+uint8_t Docview_lines_to_show(const DocviewReaderModel* model);
+uint8_t Docview_font_slot(const DocviewReaderModel* model);
+void Docview_scroll_to_bottom(DocviewReaderModel* model);
+void Docview_jump_to_offset(DocviewReaderModel* model, uint32_t offset);
+void Docview_jump_to_line(DocviewReaderModel* model, uint32_t line);
+bool Docview_wrap_step_down(DocviewReaderModel* model);
+bool Docview_wrap_step_up(DocviewReaderModel* model);
+void Docview_hex_scroll(DocviewReaderModel* model, int32_t delta);
+// One auto-scroll timer tick
+void Docview_auto_scroll_step(DocviewReaderModel* model);
+
+bool Docview_view_span(
+    DocviewReaderModel* model,
+    uint8_t lines_to_show,
+    uint32_t* start,
+    uint32_t* end);
+// Draw the header, the page and the footer. Returns false when there is no span of bytes on
+// screen to report in 'start' and 'end' to the prefetcher.
+bool Docview_draw_reader(
+    Canvas* canvas,
+    DocviewReaderModel* model,
+    uint32_t* start,
+    uint32_t* end);
+// Whether the first page is up: it is full, or there is nothing more to fill it with
+bool Docview_first_page_ready(const DocviewReaderModel* model);
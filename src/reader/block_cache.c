@@ -0,0 +1,286 @@
+#include "block_cache.h"
+#include <string.h>
+
+#define TAG "BlockCache"
+
+#define BLOCK_CACHE_SLOT_NONE SIZE_MAX
+
+typedef enum {
+    BlockCacheEntryEmpty,
+    // Being read from storage with the mutex released; invisible to lookups and eviction
+    BlockCacheEntryFilling,
+    // Invalidated while filling, dropped once the read returns
+    BlockCacheEntryDropped,
+    BlockCacheEntryValid,
+} BlockCacheEntryState;
+
+typedef struct {
+    BlockCacheEntryState state;
+    BlockCacheFile file;
+    uint32_t base;
+    uint16_t length;
+    uint32_t used;
+} BlockCacheEntry;
+
+typedef struct {
+    FuriMutex* mutex;
+    BlockCacheEntry entries[BLOCK_CACHE_BLOCK_COUNT];
+    uint8_t blocks[BLOCK_CACHE_BLOCK_COUNT][BLOCK_CACHE_BLOCK_SIZE];
+    uint32_t use_counter;
+    BlockCacheStats stats;
+} BlockCache;
+
+static BlockCache* block_cache = NULL;
+
+// FNV-1a over the file path
+static uint32_t block_cache_hash(const char* path) {
+    uint32_t hash = 2166136261UL;
+    for(const char* c = path; *c; c++) {
+        hash ^= (uint8_t)*c;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+void block_cache_init(void) {
+    if(block_cache) return;
+    BlockCache* cache = malloc(sizeof(BlockCache));
+    memset(cache, 0, sizeof(BlockCache));
+    cache->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    block_cache = cache;
+}
+
+void block_cache_deinit(void) {
+    BlockCache* cache = block_cache;
+    if(!cache) return;
+    block_cache = NULL;
+
+    uint32_t total = cache->stats.hits + cache->stats.misses;
+    FURI_LOG_D(
+        TAG,
+        "Hit rate %lu%% (%lu of %lu blocks, %lu prefetched)",
+        total ? cache->stats.hits * 100 / total : 0,
+        cache->stats.hits,
+        total,
+        cache->stats.prefetched);
+
+    furi_mutex_free(cache->mutex);
+    free(cache);
+}
+
+void block_cache_file(BlockCacheFile* id, const char* path, uint32_t size) {
+    id->key = block_cache_hash(path);
+    id->size = size;
+}
+
+static size_t block_cache_find(BlockCache* cache, const BlockCacheFile* id, uint32_t base) {
+    for(size_t i = 0; i < BLOCK_CACHE_BLOCK_COUNT; i++) {
+        BlockCacheEntry* entry = &cache->entries[i];
+        if(entry->state == BlockCacheEntryValid && entry->base == base &&
+           entry->file.key == id->key && entry->file.size == id->size) {
+            return i;
+        }
+    }
+    return BLOCK_CACHE_SLOT_NONE;
+}
+
+// Empty slots first, then the least recently used; sequential blocks sit at use 0
+static size_t block_cache_victim(BlockCache* cache) {
+    size_t victim = BLOCK_CACHE_SLOT_NONE;
+    for(size_t i = 0; i < BLOCK_CACHE_BLOCK_COUNT; i++) {
+        BlockCacheEntry* entry = &cache->entries[i];
+        if(entry->state == BlockCacheEntryEmpty) return i;
+        if(entry->state != BlockCacheEntryValid) continue;
+        if(victim == BLOCK_CACHE_SLOT_NONE || entry->used < cache->entries[victim].used) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+static uint16_t block_cache_fill(File* file, uint32_t base, uint8_t* block) {
+    if(!storage_file_seek(file, base, true)) {
+        FURI_LOG_E(TAG, "Seek to %lu failed", base);
+        return 0;
+    }
+    return storage_file_read(file, block, BLOCK_CACHE_BLOCK_SIZE);
+}
+
+// Find the block at 'base', reading it on a miss. Returns its slot with the mutex held, or
+// BLOCK_CACHE_SLOT_NONE with the mutex released when every slot is being filled.
+static size_t block_cache_lookup(
+    BlockCache* cache,
+    const BlockCacheFile* id,
+    File* file,
+    uint32_t base,
+    BlockCacheHint hint,
+    bool* hit) {
+    furi_check(furi_mutex_acquire(cache->mutex, FuriWaitForever) == FuriStatusOk);
+
+    size_t slot = block_cache_find(cache, id, base);
+    *hit = slot != BLOCK_CACHE_SLOT_NONE;
+    if(!*hit) {
+        slot = block_cache_victim(cache);
+        if(slot == BLOCK_CACHE_SLOT_NONE) {
+            furi_mutex_release(cache->mutex);
+            return slot;
+        }
+
+        BlockCacheEntry* entry = &cache->entries[slot];
+        entry->state = BlockCacheEntryFilling;
+        entry->file = *id;
+        entry->base = base;
+        entry->used = 0;
+        furi_mutex_release(cache->mutex);
+
+        uint16_t length = block_cache_fill(file, base, cache->blocks[slot]);
+
+        furi_check(furi_mutex_acquire(cache->mutex, FuriWaitForever) == FuriStatusOk);
+        bool keep = entry->state == BlockCacheEntryFilling && length > 0;
+        entry->state = keep ? BlockCacheEntryValid : BlockCacheEntryEmpty;
+        entry->length = length;
+    }
+
+    BlockCacheEntry* entry = &cache->entries[slot];
+    if(hint == BlockCacheHintRandom && entry->state == BlockCacheEntryValid) {
+        entry->used = ++cache->use_counter;
+    }
+    return slot;
+}
+
+// Copy 'size' bytes at 'in_block' of the block at 'base', which must not cross its end
+static bool block_cache_copy(
+    BlockCache* cache,
+    const BlockCacheFile* id,
+    File* file,
+    uint32_t base,
+    size_t in_block,
+    uint8_t* out,
+    size_t size,
+    BlockCacheHint hint) {
+    bool hit;
+    size_t slot = block_cache_lookup(cache, id, file, base, hint, &hit);
+    if(slot == BLOCK_CACHE_SLOT_NONE) {
+        // Every block is being filled by another reader
+        uint8_t* block = malloc(BLOCK_CACHE_BLOCK_SIZE);
+        bool copied = block_cache_fill(file, base, block) >= in_block + size;
+        if(copied) memcpy(out, block + in_block, size);
+        free(block);
+        return copied;
+    }
+
+    BlockCacheEntry* entry = &cache->entries[slot];
+    if(hit) {
+        cache->stats.hits++;
+    } else {
+        cache->stats.misses++;
+    }
+
+    // A short block means the file changed under us or the read failed
+    bool copied = entry->length >= in_block + size;
+    if(copied) memcpy(out, cache->blocks[slot] + in_block, size);
+    if(!copied) entry->state = BlockCacheEntryEmpty;
+
+    furi_mutex_release(cache->mutex);
+    return copied;
+}
+
+size_t block_cache_read(
+    const BlockCacheFile* id,
+    File* file,
+    uint32_t offset,
+    uint8_t* out,
+    size_t size,
+    BlockCacheHint hint) {
+    furi_assert(id);
+    furi_assert(file);
+    if(offset >= id->size) return 0;
+    if(size > id->size - offset) size = id->size - offset;
+
+    BlockCache* cache = block_cache;
+    if(!cache) {
+        if(!storage_file_seek(file, offset, true)) return 0;
+        return storage_file_read(file, out, size);
+    }
+
+    size_t copied = 0;
+    while(copied < size) {
+        uint32_t position = offset + (uint32_t)copied;
+        size_t in_block = position % BLOCK_CACHE_BLOCK_SIZE;
+        size_t chunk = BLOCK_CACHE_BLOCK_SIZE - in_block;
+        if(chunk > size - copied) chunk = size - copied;
+
+        if(!block_cache_copy(
+               cache, id, file, position - in_block, in_block, out + copied, chunk, hint)) {
+            break;
+        }
+        copied += chunk;
+    }
+    return copied;
+}
+
+void block_cache_prefetch(const BlockCacheFile* id, File* file, uint32_t offset, size_t size) {
+    furi_assert(id);
+    furi_assert(file);
+    BlockCache* cache = block_cache;
+    if(!cache || offset >= id->size) return;
+    if(size > id->size - offset) size = id->size - offset;
+
+    uint32_t base = offset - offset % BLOCK_CACHE_BLOCK_SIZE;
+    for(; base < offset + size; base += BLOCK_CACHE_BLOCK_SIZE) {
+        bool hit;
+        size_t slot = block_cache_lookup(cache, id, file, base, BlockCacheHintRandom, &hit);
+        if(slot == BLOCK_CACHE_SLOT_NONE) break;
+        if(!hit) cache->stats.prefetched++;
+        furi_mutex_release(cache->mutex);
+    }
+}
+
+void block_cache_grow(const BlockCacheFile* from, uint32_t size) {
+    furi_assert(from);
+    BlockCache* cache = block_cache;
+    if(!cache) return;
+
+    furi_check(furi_mutex_acquire(cache->mutex, FuriWaitForever) == FuriStatusOk);
+    for(size_t i = 0; i < BLOCK_CACHE_BLOCK_COUNT; i++) {
+        BlockCacheEntry* entry = &cache->entries[i];
+        if(entry->state != BlockCacheEntryValid || entry->file.key != from->key ||
+           entry->file.size != from->size) {
+            continue;
+        }
+        if(entry->length == BLOCK_CACHE_BLOCK_SIZE) {
+            entry->file.size = size;
+        } else {
+            entry->state = BlockCacheEntryEmpty;
+        }
+    }
+    furi_mutex_release(cache->mutex);
+}
+
+void block_cache_invalidate(const char* path) {
+    BlockCache* cache = block_cache;
+    if(!cache) return;
+
+    uint32_t key = block_cache_hash(path);
+    furi_check(furi_mutex_acquire(cache->mutex, FuriWaitForever) == FuriStatusOk);
+    for(size_t i = 0; i < BLOCK_CACHE_BLOCK_COUNT; i++) {
+        BlockCacheEntry* entry = &cache->entries[i];
+        if(entry->file.key != key) continue;
+        if(entry->state == BlockCacheEntryValid) entry->state = BlockCacheEntryEmpty;
+        if(entry->state == BlockCacheEntryFilling) entry->state = BlockCacheEntryDropped;
+    }
+    furi_mutex_release(cache->mutex);
+}
+
+void block_cache_get_stats(BlockCacheStats* stats) {
+    furi_assert(stats);
+    BlockCache* cache = block_cache;
+    if(!cache) {
+        memset(stats, 0, sizeof(BlockCacheStats));
+        return;
+    }
+
+    furi_check(furi_mutex_acquire(cache->mutex, FuriWaitForever) == FuriStatusOk);
+    *stats = cache->stats;
+    furi_mutex_release(cache->mutex);
+}
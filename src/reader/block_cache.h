@@ -0,0 +1,58 @@
+#pragma once
+
+#include <furi.h>
+#include <storage/storage.h>
+
+// Blocks are SD sectors, so every miss is one aligned read
+#define BLOCK_CACHE_BLOCK_SIZE  512
+#define BLOCK_CACHE_BLOCK_COUNT 12
+
+typedef enum {
+    // Blocks read this way become the most recently used
+    BlockCacheHintRandom,
+    // Bulk scans: hits are not refreshed and misses are evicted first, so a scan over a
+    // large file reuses what the reader has cached without flushing it
+    BlockCacheHintSequential,
+} BlockCacheHint;
+
+// Which file a block belongs to. The size is part of it, so a file that grew or was
+// replaced since its blocks were cached never hits them.
+typedef struct {
+    uint32_t key;
+    uint32_t size;
+} BlockCacheFile;
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t prefetched; // Blocks read ahead of any request for them
+} BlockCacheStats;
+
+// Allocate the shared pool; reads before init or after deinit go straight to storage
+void block_cache_init(void);
+void block_cache_deinit(void);
+
+void block_cache_file(BlockCacheFile* id, const char* path, uint32_t size);
+
+// Copy up to 'size' bytes at 'offset' of 'id' into 'out', reading missing blocks through
+// 'file'. Returns the number of bytes copied, short only at end of file or on error.
+size_t block_cache_read(
+    const BlockCacheFile* id,
+    File* file,
+    uint32_t offset,
+    uint8_t* out,
+    size_t size,
+    BlockCacheHint hint);
+
+// Read the blocks covering 'size' bytes at 'offset' into the cache as most recently used,
+// without copying them anywhere
+void block_cache_prefetch(const BlockCacheFile* id, File* file, uint32_t offset, size_t size);
+
+// Move the blocks of a file that grew from 'from->size' to 'size' over to its new identity.
+// Only its last block, which may have been short, is dropped.
+void block_cache_grow(const BlockCacheFile* from, uint32_t size);
+
+// Drop every block of 'path', for files rewritten in place
+void block_cache_invalidate(const char* path);
+
+void block_cache_get_stats(BlockCacheStats* stats);
@@ -0,0 +1,91 @@
+#include "doc_prefetch.h"
+#include <storage/storage.h>
+#include <string.h>
+
+#define TAG "DocPrefetch"
+
+#define DOC_PREFETCH_STACK_SIZE 1024
+
+#define DOC_PREFETCH_FLAG_STOP    (1 << 0)
+#define DOC_PREFETCH_FLAG_REQUEST (1 << 1)
+#define DOC_PREFETCH_FLAG_ALL     (DOC_PREFETCH_FLAG_STOP | DOC_PREFETCH_FLAG_REQUEST)
+
+struct DocPrefetch {
+    Storage* storage;
+    File* file;
+    BlockCacheFile id;
+    FuriThread* thread;
+
+    // Written by the drawing thread; a torn pair only prefetches the wrong blocks once
+    volatile uint32_t offset;
+    volatile uint32_t size;
+
+    uint32_t view_start;
+    bool backward;
+};
+
+static int32_t doc_prefetch_thread(void* context) {
+    DocPrefetch* prefetch = context;
+
+    for(;;) {
+        uint32_t flags =
+            furi_thread_flags_wait(DOC_PREFETCH_FLAG_ALL, FuriFlagWaitAny, FuriWaitForever);
+        if(flags & FuriFlagError) continue;
+        if(flags & DOC_PREFETCH_FLAG_STOP) break;
+
+        block_cache_prefetch(&prefetch->id, prefetch->file, prefetch->offset, prefetch->size);
+    }
+
+    return 0;
+}
+
+DocPrefetch* doc_prefetch_alloc(const char* path) {
+    DocPrefetch* prefetch = malloc(sizeof(DocPrefetch));
+    memset(prefetch, 0, sizeof(DocPrefetch));
+    prefetch->storage = furi_record_open(RECORD_STORAGE);
+    prefetch->file = storage_file_alloc(prefetch->storage);
+
+    if(storage_file_open(prefetch->file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        block_cache_file(&prefetch->id, path, (uint32_t)storage_file_size(prefetch->file));
+    } else {
+        // Requests fall past the end of an empty file and are ignored
+        FURI_LOG_E(TAG, "Failed to open %s", path);
+    }
+
+    prefetch->thread = furi_thread_alloc_ex(
+        "DocPrefetch", DOC_PREFETCH_STACK_SIZE, doc_prefetch_thread, prefetch);
+    furi_thread_start(prefetch->thread);
+    return prefetch;
+}
+
+void doc_prefetch_free(DocPrefetch* prefetch) {
+    furi_assert(prefetch);
+    furi_thread_flags_set(furi_thread_get_id(prefetch->thread), DOC_PREFETCH_FLAG_STOP);
+    furi_thread_join(prefetch->thread);
+    furi_thread_free(prefetch->thread);
+
+    storage_file_close(prefetch->file);
+    storage_file_free(prefetch->file);
+    furi_record_close(RECORD_STORAGE);
+    free(prefetch);
+}
+
+void doc_prefetch_view(DocPrefetch* prefetch, uint32_t start, uint32_t end) {
+    furi_assert(prefetch);
+    // Redraws that did not move keep the last direction
+    if(start != prefetch->view_start) prefetch->backward = start < prefetch->view_start;
+    prefetch->view_start = start;
+
+    uint32_t offset = end;
+    uint32_t size = DOC_PREFETCH_AHEAD;
+    if(prefetch->backward) {
+        offset = start > DOC_PREFETCH_AHEAD ? start - DOC_PREFETCH_AHEAD : 0;
+        size = start - offset;
+    }
+    if(size == 0 || offset >= prefetch->id.size) return;
+    if(offset == prefetch->offset && size == prefetch->size) return;
+
+    prefetch->offset = offset;
+    prefetch->size = size;
+    furi_thread_flags_set(furi_thread_get_id(prefetch->thread), DOC_PREFETCH_FLAG_REQUEST);
+}
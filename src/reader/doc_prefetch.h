@@ -0,0 +1,17 @@
+#pragma once
+
+#include <furi.h>
+#include "block_cache.h"
+
+// How far past the screen edge, in the direction of travel, is kept in the block cache
+#define DOC_PREFETCH_AHEAD (2 * BLOCK_CACHE_BLOCK_SIZE)
+
+typedef struct DocPrefetch DocPrefetch;
+
+// Open 'path' and start a thread that reads upcoming blocks into the block cache
+DocPrefetch* doc_prefetch_alloc(const char* path);
+void doc_prefetch_free(DocPrefetch* prefetch);
+
+// Report the bytes [start, end) a frame was drawn from. The direction is taken from how the
+// view moved since the last call, and the blocks past that edge are requested.
+void doc_prefetch_view(DocPrefetch* prefetch, uint32_t start, uint32_t end);
@@ -0,0 +1,134 @@
+#include "doc_search.h"
+#include <string.h>
+
+struct DocSearch {
+    uint8_t needle[DOC_SEARCH_NEEDLE_MAX];
+    uint8_t length;
+    bool ignore_case;
+    uint8_t skip[256];
+    uint8_t chunk[DOC_SEARCH_CHUNK_SIZE + DOC_SEARCH_NEEDLE_MAX];
+};
+
+static inline uint8_t doc_search_fold(const DocSearch* search, uint8_t c) {
+    if(search->ignore_case && c >= 'A' && c <= 'Z') return c + ('a' - 'A');
+    return c;
+}
+
+DocSearch* doc_search_alloc(void) {
+    DocSearch* search = malloc(sizeof(DocSearch));
+    memset(search, 0, sizeof(DocSearch));
+    return search;
+}
+
+void doc_search_free(DocSearch* search) {
+    furi_assert(search);
+    free(search);
+}
+
+bool doc_search_set_needle(DocSearch* search, const char* needle, bool ignore_case) {
+    furi_assert(search);
+    size_t length = strlen(needle);
+    if(length == 0 || length > DOC_SEARCH_NEEDLE_MAX) return false;
+
+    search->length = (uint8_t)length;
+    search->ignore_case = ignore_case;
+    for(size_t i = 0; i < length; i++) {
+        search->needle[i] = doc_search_fold(search, (uint8_t)needle[i]);
+    }
+
+    // Horspool shift: distance from the last occurrence of a byte to the end of the needle
+    memset(search->skip, search->length, sizeof(search->skip));
+    for(size_t i = 0; i + 1 < length; i++) {
+        uint8_t shift = (uint8_t)(length - 1 - i);
+        search->skip[search->needle[i]] = shift;
+        if(ignore_case && search->needle[i] >= 'a' && search->needle[i] <= 'z') {
+            search->skip[search->needle[i] - ('a' - 'A')] = shift;
+        }
+    }
+    return true;
+}
+
+// Position of the first (or last) match inside 'data', or -1
+static int32_t
+    doc_search_scan(const DocSearch* search, const uint8_t* data, size_t size, bool last) {
+    size_t length = search->length;
+    uint8_t tail = search->needle[length - 1];
+    int32_t found = -1;
+
+    for(size_t i = 0; i + length <= size;) {
+        uint8_t c = data[i + length - 1];
+        if(doc_search_fold(search, c) == tail) {
+            size_t j = 0;
+            while(j + 1 < length && doc_search_fold(search, data[i + j]) == search->needle[j]) {
+                j++;
+            }
+            if(j + 1 == length) {
+                if(!last) return (int32_t)i;
+                found = (int32_t)i;
+            }
+        }
+        i += search->skip[c];
+    }
+
+    return found;
+}
+
+uint32_t doc_search_forward(DocSearch* search, DocStream* stream, uint32_t from, uint32_t limit) {
+    furi_assert(search);
+    furi_assert(search->length);
+
+    // A match starting below 'limit' may end up to length - 1 bytes past it
+    uint32_t end = limit + search->length - 1;
+    uint32_t size = doc_stream_size(stream);
+    if(end > size || end < limit) end = size;
+
+    uint32_t base = from;
+    size_t kept = 0;
+    while(base + kept < end) {
+        size_t want = end - base - kept;
+        if(want > DOC_SEARCH_CHUNK_SIZE) want = DOC_SEARCH_CHUNK_SIZE;
+        size_t got = doc_stream_read_direct(stream, base + kept, search->chunk + kept, want);
+        if(got == 0) break;
+
+        size_t filled = kept + got;
+        int32_t match = doc_search_scan(search, search->chunk, filled, false);
+        if(match >= 0) return base + (uint32_t)match;
+
+        // Carry the bytes a match could still start in over to the next chunk
+        kept = filled < search->length ? filled : search->length - 1u;
+        memmove(search->chunk, search->chunk + filled - kept, kept);
+        base += filled - kept;
+    }
+
+    return DOC_SEARCH_NONE;
+}
+
+uint32_t doc_search_backward(DocSearch* search, DocStream* stream, uint32_t from, uint32_t limit) {
+    furi_assert(search);
+    furi_assert(search->length);
+
+    uint32_t end = from + search->length - 1;
+    uint32_t size = doc_stream_size(stream);
+    if(end > size || end < from) end = size;
+
+    // Chunks are read from the end; the head of each is kept after the one before it
+    size_t kept = 0;
+    while(end - kept > limit) {
+        uint32_t top = end - kept;
+        size_t want = top - limit;
+        if(want > DOC_SEARCH_CHUNK_SIZE) want = DOC_SEARCH_CHUNK_SIZE;
+        uint32_t base = top - want;
+
+        memmove(search->chunk + want, search->chunk, kept);
+        if(doc_stream_read_direct(stream, base, search->chunk, want) != want) break;
+
+        size_t filled = want + kept;
+        int32_t match = doc_search_scan(search, search->chunk, filled, true);
+        if(match >= 0 && base + (uint32_t)match < from) return base + (uint32_t)match;
+
+        kept = filled < search->length ? filled : search->length - 1u;
+        end = base + kept;
+    }
+
+    return DOC_SEARCH_NONE;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <furi.h>
+#include "doc_stream.h"
+
+#define DOC_SEARCH_NEEDLE_MAX 32
+// Bytes read per storage request; consecutive chunks overlap by needle length - 1
+#define DOC_SEARCH_CHUNK_SIZE 2048
+
+#define DOC_SEARCH_NONE UINT32_MAX
+
+typedef struct DocSearch DocSearch;
+
+DocSearch* doc_search_alloc(void);
+void doc_search_free(DocSearch* search);
+
+// Build the skip table for 'needle'; false if it is empty or longer than DOC_SEARCH_NEEDLE_MAX
+bool doc_search_set_needle(DocSearch* search, const char* needle, bool ignore_case);
+
+// Offset of the first match starting in [from, limit), or DOC_SEARCH_NONE
+uint32_t doc_search_forward(DocSearch* search, DocStream* stream, uint32_t from, uint32_t limit);
+
+// Offset of the last match starting in [limit, from), or DOC_SEARCH_NONE
+uint32_t doc_search_backward(DocSearch* search, DocStream* stream, uint32_t from, uint32_t limit);
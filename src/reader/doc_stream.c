@@ -0,0 +1,249 @@
+#include "doc_stream.h"
+#include "text_scan.h"
+#include <string.h>
+
+#define TAG "DocStream"
+
+#define DOC_STREAM_PAGE_NONE UINT32_MAX
+
+struct DocStream {
+    Storage* storage;
+    File* file;
+    File* spare; // The grown file, opened by doc_stream_reopen()
+    uint32_t spare_size;
+    bool reopened;
+    FuriString* path;
+    bool is_open;
+    uint32_t size;
+    BlockCacheFile id;
+    BlockCacheHint hint;
+
+    uint8_t pages[DOC_STREAM_PAGE_COUNT][DOC_STREAM_PAGE_SIZE];
+    uint32_t page_offset[DOC_STREAM_PAGE_COUNT];
+    uint16_t page_length[DOC_STREAM_PAGE_COUNT];
+    uint32_t page_used[DOC_STREAM_PAGE_COUNT];
+    uint32_t use_counter;
+};
+
+static void doc_stream_drop_pages(DocStream* stream) {
+    for(size_t i = 0; i < DOC_STREAM_PAGE_COUNT; i++) {
+        stream->page_offset[i] = DOC_STREAM_PAGE_NONE;
+        stream->page_length[i] = 0;
+        stream->page_used[i] = 0;
+    }
+    stream->use_counter = 0;
+}
+
+DocStream* doc_stream_alloc(void) {
+    DocStream* stream = malloc(sizeof(DocStream));
+    memset(stream, 0, sizeof(DocStream));
+    stream->storage = furi_record_open(RECORD_STORAGE);
+    stream->file = storage_file_alloc(stream->storage);
+    stream->spare = storage_file_alloc(stream->storage);
+    stream->path = furi_string_alloc();
+    doc_stream_drop_pages(stream);
+    return stream;
+}
+
+void doc_stream_free(DocStream* stream) {
+    furi_assert(stream);
+    doc_stream_close(stream);
+    storage_file_free(stream->file);
+    storage_file_free(stream->spare);
+    furi_string_free(stream->path);
+    furi_record_close(RECORD_STORAGE);
+    free(stream);
+}
+
+bool doc_stream_open(DocStream* stream, const char* path) {
+    furi_assert(stream);
+    doc_stream_close(stream);
+
+    if(!storage_file_open(stream->file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        FURI_LOG_E(TAG, "Failed to open %s", path);
+        storage_file_close(stream->file);
+        return false;
+    }
+
+    stream->size = (uint32_t)storage_file_size(stream->file);
+    furi_string_set_str(stream->path, path);
+    block_cache_file(&stream->id, path, stream->size);
+    stream->is_open = true;
+    return true;
+}
+
+void doc_stream_close(DocStream* stream) {
+    furi_assert(stream);
+    if(stream->is_open) {
+        storage_file_close(stream->file);
+        stream->is_open = false;
+    }
+    if(stream->reopened) {
+        storage_file_close(stream->spare);
+        stream->reopened = false;
+    }
+    stream->size = 0;
+    doc_stream_drop_pages(stream);
+}
+
+bool doc_stream_is_open(const DocStream* stream) {
+    furi_assert(stream);
+    return stream->is_open;
+}
+
+uint32_t doc_stream_size(const DocStream* stream) {
+    furi_assert(stream);
+    return stream->size;
+}
+
+bool doc_stream_reopen(DocStream* stream) {
+    furi_assert(stream);
+    if(!stream->is_open) return false;
+    if(stream->reopened) return true;
+
+    const char* path = furi_string_get_cstr(stream->path);
+    FileInfo info;
+    if(storage_common_stat(stream->storage, path, &info) != FSE_OK) return false;
+    if(info.size <= stream->size) return false;
+
+    // An open file keeps the size it had when it was opened
+    if(!storage_file_open(stream->spare, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        FURI_LOG_E(TAG, "Failed to reopen %s", path);
+        storage_file_close(stream->spare);
+        return false;
+    }
+    stream->spare_size = (uint32_t)storage_file_size(stream->spare);
+    stream->reopened = true;
+    return true;
+}
+
+bool doc_stream_refresh(DocStream* stream) {
+    furi_assert(stream);
+    if(!doc_stream_reopen(stream)) return false;
+
+    File* old_file = stream->file;
+    stream->file = stream->spare;
+    stream->spare = old_file;
+    storage_file_close(stream->spare);
+    stream->reopened = false;
+
+    BlockCacheFile previous = stream->id;
+    stream->size = stream->spare_size;
+    block_cache_file(&stream->id, furi_string_get_cstr(stream->path), stream->size);
+    block_cache_grow(&previous, stream->size);
+    // The last page may have been short
+    doc_stream_drop_pages(stream);
+    return true;
+}
+
+void doc_stream_set_hint(DocStream* stream, BlockCacheHint hint) {
+    furi_assert(stream);
+    stream->hint = hint;
+}
+
+static size_t doc_stream_fill_page(DocStream* stream, uint32_t page_base) {
+    size_t victim = 0;
+    for(size_t i = 0; i < DOC_STREAM_PAGE_COUNT; i++) {
+        if(stream->page_offset[i] == page_base) return i;
+        if(stream->page_used[i] < stream->page_used[victim]) victim = i;
+    }
+
+    size_t length = block_cache_read(
+        &stream->id,
+        stream->file,
+        page_base,
+        stream->pages[victim],
+        DOC_STREAM_PAGE_SIZE,
+        stream->hint);
+    stream->page_offset[victim] = length ? page_base : DOC_STREAM_PAGE_NONE;
+    stream->page_length[victim] = length;
+
+    return victim;
+}
+
+const uint8_t* doc_stream_peek(DocStream* stream, uint32_t offset, size_t* available) {
+    furi_assert(stream);
+    *available = 0;
+    if(!stream->is_open || offset >= stream->size) return NULL;
+
+    uint32_t page_base = offset - (offset % DOC_STREAM_PAGE_SIZE);
+    size_t page = doc_stream_fill_page(stream, page_base);
+    if(stream->page_offset[page] != page_base) return NULL;
+
+    stream->page_used[page] = ++stream->use_counter;
+
+    uint32_t in_page = offset - page_base;
+    if(in_page >= stream->page_length[page]) return NULL;
+
+    *available = stream->page_length[page] - in_page;
+    return stream->pages[page] + in_page;
+}
+
+size_t doc_stream_read(DocStream* stream, uint32_t offset, uint8_t* out, size_t size) {
+    size_t copied = 0;
+    while(copied < size) {
+        size_t available;
+        const uint8_t* data = doc_stream_peek(stream, offset + copied, &available);
+        if(!data) break;
+        if(available > size - copied) available = size - copied;
+        memcpy(out + copied, data, available);
+        copied += available;
+    }
+    return copied;
+}
+
+size_t doc_stream_read_direct(DocStream* stream, uint32_t offset, uint8_t* out, size_t size) {
+    furi_assert(stream);
+    if(!stream->is_open) return 0;
+    return block_cache_read(
+        &stream->id, stream->file, offset, out, size, BlockCacheHintSequential);
+}
+
+uint32_t doc_stream_next_line(DocStream* stream, uint32_t offset) {
+    uint32_t limit = offset + DOC_STREAM_LINE_MAX;
+    if(limit > stream->size) limit = stream->size;
+
+    uint32_t position = offset;
+    while(position < limit) {
+        size_t available;
+        const uint8_t* data = doc_stream_peek(stream, position, &available);
+        if(!data) return limit;
+        if(available > limit - position) available = limit - position;
+
+        size_t newline = text_scan_newline(data, available);
+        if(newline < available) return position + (uint32_t)newline + 1;
+        position += available;
+    }
+
+    return limit;
+}
+
+uint32_t
+    doc_stream_prev_lines(DocStream* stream, uint32_t offset, uint32_t lines, uint32_t limit) {
+    furi_assert(stream);
+    if(offset > stream->size) offset = stream->size;
+    uint32_t floor = offset > limit ? offset - limit : 0;
+    if(offset < 2) return floor;
+
+    // A line starts after every '\n'; the byte just before 'offset' ends the line above it
+    uint32_t found = 0;
+    uint32_t end = offset - 1;
+    while(end > floor) {
+        uint32_t base = (end - 1) - (end - 1) % DOC_STREAM_PAGE_SIZE;
+        if(base < floor) base = floor;
+
+        size_t available;
+        const uint8_t* data = doc_stream_peek(stream, base, &available);
+        if(!data) break;
+        size_t count = end - base;
+        if(count > available) count = available;
+
+        while(count > 0) {
+            count--;
+            if(data[count] == '\n' && ++found == lines) return base + (uint32_t)count + 1;
+        }
+        end = base;
+    }
+
+    return floor;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <furi.h>
+#include <storage/storage.h>
+#include "block_cache.h"
+
+// Size of one window page; pages are refilled from the shared block cache, one block each
+#define DOC_STREAM_PAGE_SIZE  BLOCK_CACHE_BLOCK_SIZE
+#define DOC_STREAM_PAGE_COUNT 2
+
+// Lines longer than this are split so a single line never outgrows the window
+#define DOC_STREAM_LINE_MAX 1024
+
+typedef struct DocStream DocStream;
+
+// Allocate a stream with a fixed window of DOC_STREAM_PAGE_COUNT pages
+DocStream* doc_stream_alloc(void);
+void doc_stream_free(DocStream* stream);
+
+// Open 'path' for paged reading; nothing is read until a page is requested
+bool doc_stream_open(DocStream* stream, const char* path);
+void doc_stream_close(DocStream* stream);
+bool doc_stream_is_open(const DocStream* stream);
+// Stat the file and, when it grew since it was opened, open it again on the side. The stream
+// keeps reading the old handle, so this may run while another thread reads the stream.
+bool doc_stream_reopen(DocStream* stream);
+// Pick up bytes appended to the file since it was opened, through the handle
+// doc_stream_reopen() left, or reopening it now; returns whether it grew
+bool doc_stream_refresh(DocStream* stream);
+uint32_t doc_stream_size(const DocStream* stream);
+
+// How the stream's page refills use the block cache, BlockCacheHintRandom by default
+void doc_stream_set_hint(DocStream* stream, BlockCacheHint hint);
+
+// Return the bytes at 'offset' inside the window and how many follow it in that page.
+// Refills the least recently used page from the block cache on a miss; NULL past end of file.
+const uint8_t* doc_stream_peek(DocStream* stream, uint32_t offset, size_t* available);
+
+// Copy up to 'size' bytes at 'offset' into 'out', returns the number of bytes copied
+size_t doc_stream_read(DocStream* stream, uint32_t offset, uint8_t* out, size_t size);
+
+// Read 'size' bytes at 'offset' straight into 'out', bypassing the window, as a sequential
+// block cache read. Meant for bulk scans that would otherwise evict the reader's pages.
+size_t doc_stream_read_direct(DocStream* stream, uint32_t offset, uint8_t* out, size_t size);
+
+// Return the offset of the line following the one starting at 'offset'
+uint32_t doc_stream_next_line(DocStream* stream, uint32_t offset);
+
+// Walk backwards from 'offset' to the start of the 'lines'th line before it, looking at no
+// more than 'limit' bytes. Returns that line start, the top of the file, or 'offset - limit'
+// when the lines run longer than the limit.
+uint32_t doc_stream_prev_lines(DocStream* stream, uint32_t offset, uint32_t lines, uint32_t limit);
@@ -0,0 +1,160 @@
+#include "index_cache.h"
+#include <storage/storage.h>
+#include <string.h>
+
+#define TAG "IndexCache"
+
+#define INDEX_CACHE_MAGIC   0x58495644 // "DVIX"
+#define INDEX_CACHE_VERSION 3
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t path_length;
+    uint32_t file_size;
+    uint32_t file_timestamp;
+    uint8_t complete;
+    uint8_t reserved[3];
+} FURI_PACKED IndexCacheHeader;
+
+// FNV-1a over the document path
+static uint32_t index_cache_hash(const char* path) {
+    uint32_t hash = 2166136261UL;
+    for(const char* c = path; *c; c++) {
+        hash ^= (uint8_t)*c;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static void index_cache_sidecar_path(const char* path, char* out, size_t size) {
+    snprintf(out, size, "%s/%08lx.idx", INDEX_CACHE_FOLDER, index_cache_hash(path));
+}
+
+static bool index_cache_stat(Storage* storage, const char* path, IndexCacheKey* key) {
+    FileInfo info;
+    if(storage_common_stat(storage, path, &info) != FSE_OK) return false;
+    if(storage_common_timestamp(storage, path, &key->file_timestamp) != FSE_OK) return false;
+    key->file_size = (uint32_t)info.size;
+    return true;
+}
+
+bool index_cache_key(const char* path, IndexCacheKey* key) {
+    furi_assert(path);
+    furi_assert(key);
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    bool ok = index_cache_stat(storage, path, key);
+    furi_record_close(RECORD_STORAGE);
+    return ok;
+}
+
+bool index_cache_load(
+    const char* path,
+    const IndexCacheKey* key,
+    LineIndex* index,
+    bool* complete) {
+    furi_assert(path);
+    furi_assert(key);
+    furi_assert(index);
+
+    char sidecar[64];
+    index_cache_sidecar_path(path, sidecar, sizeof(sidecar));
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    bool loaded = false;
+
+    do {
+        if(!storage_file_open(file, sidecar, FSAM_READ, FSOM_OPEN_EXISTING)) break;
+
+        IndexCacheHeader header;
+        if(storage_file_read(file, &header, sizeof(header)) != sizeof(header)) break;
+        if(header.magic != INDEX_CACHE_MAGIC || header.version != INDEX_CACHE_VERSION) break;
+        if(header.file_size != key->file_size || header.file_timestamp != key->file_timestamp) {
+            break;
+        }
+
+        // Guard against two paths sharing a hash
+        size_t path_length = strlen(path);
+        if(header.path_length != path_length) break;
+        char stored_path[256];
+        if(path_length >= sizeof(stored_path)) break;
+        if(storage_file_read(file, stored_path, path_length) != path_length) break;
+        if(memcmp(stored_path, path, path_length) != 0) break;
+
+        if(!line_index_read(index, file)) {
+            line_index_reset(index);
+            break;
+        }
+        if(line_index_end(index) > key->file_size) {
+            line_index_reset(index);
+            break;
+        }
+
+        // Complete means the lines reach the end of the file
+        *complete = header.complete && line_index_end(index) == key->file_size;
+        loaded = true;
+        FURI_LOG_I(TAG, "Reused %lu lines for %s", line_index_count(index), path);
+    } while(false);
+
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    return loaded;
+}
+
+bool index_cache_save(
+    const char* path,
+    const IndexCacheKey* key,
+    const LineIndex* index,
+    bool complete) {
+    furi_assert(path);
+    furi_assert(key);
+    furi_assert(index);
+    // A partial index has no line numbers to save
+    if(line_index_origin(index) != 0) return false;
+
+    char sidecar[64];
+    index_cache_sidecar_path(path, sidecar, sizeof(sidecar));
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+
+    // An index of bytes the file no longer holds could never be loaded again
+    IndexCacheKey now;
+    if(!index_cache_stat(storage, path, &now) || now.file_size != key->file_size ||
+       now.file_timestamp != key->file_timestamp) {
+        FURI_LOG_D(TAG, "%s changed since it was indexed", path);
+        furi_record_close(RECORD_STORAGE);
+        return false;
+    }
+
+    File* file = storage_file_alloc(storage);
+    bool saved = false;
+
+    do {
+        IndexCacheHeader header = {
+            .magic = INDEX_CACHE_MAGIC,
+            .version = INDEX_CACHE_VERSION,
+            .path_length = strlen(path),
+            .file_size = key->file_size,
+            .file_timestamp = key->file_timestamp,
+            .complete = complete,
+        };
+
+        storage_simply_mkdir(storage, INDEX_CACHE_FOLDER);
+        if(!storage_file_open(file, sidecar, FSAM_WRITE, FSOM_CREATE_ALWAYS)) break;
+        if(storage_file_write(file, &header, sizeof(header)) != sizeof(header)) break;
+        if(storage_file_write(file, path, header.path_length) != header.path_length) break;
+        if(!line_index_write(index, file)) break;
+        saved = true;
+    } while(false);
+
+    storage_file_close(file);
+    if(!saved) {
+        storage_common_remove(storage, sidecar);
+        FURI_LOG_W(TAG, "Failed to save index for %s", path);
+    }
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    return saved;
+}
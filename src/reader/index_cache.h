@@ -0,0 +1,33 @@
+#pragma once
+
+#include <furi.h>
+#include "line_index.h"
+
+// Sidecar files live here, one per document, named after a hash of its path
+#define INDEX_CACHE_FOLDER APP_DATA_PATH("index")
+
+// The state of a document its line index was built from
+typedef struct {
+    uint32_t file_size;
+    uint32_t file_timestamp;
+} IndexCacheKey;
+
+// Read the key of 'path' as it is now. Take it when the document is opened, so a save
+// describes the bytes that were indexed rather than what the file has grown into since.
+bool index_cache_key(const char* path, IndexCacheKey* key);
+
+// Restore the line index saved for 'path' if it was built from 'key';
+// 'complete' reports whether the saved index reached end of file
+bool index_cache_load(
+    const char* path,
+    const IndexCacheKey* key,
+    LineIndex* index,
+    bool* complete);
+
+// Save the line index for 'path' under 'key'. Nothing is written, and an existing sidecar is
+// kept, for an index that does not start at the top or a file that changed since 'key'.
+bool index_cache_save(
+    const char* path,
+    const IndexCacheKey* key,
+    const LineIndex* index,
+    bool complete);
@@ -0,0 +1,411 @@
+#include "line_index.h"
+#include <string.h>
+
+#define TAG "LineIndex"
+
+#define LINE_INDEX_CHECKPOINTS_GROW 64
+#define LINE_INDEX_BLOCK_NONE       UINT32_MAX
+#define LINE_INDEX_SEGMENT_NONE     UINT32_MAX
+#define LINE_INDEX_BLOCK_SEGMENTS   (LINE_INDEX_BLOCK_LINES / LINE_INDEX_SEGMENT_LINES)
+// Segment 0 of a block starts at its checkpoint, so only the others have a mark
+#define LINE_INDEX_BLOCK_MARKS (LINE_INDEX_BLOCK_SEGMENTS - 1)
+
+// Line offsets of one block relative to its checkpoint. A block spans at most
+// LINE_INDEX_BLOCK_LINES * DOC_STREAM_LINE_MAX bytes, which always fits 16 bits.
+typedef struct {
+    uint32_t block;
+    uint16_t deltas[LINE_INDEX_BLOCK_LINES];
+} LineIndexBlock;
+
+// Decoded line offsets of one segment, relative to the checkpoint of its block
+typedef struct {
+    uint32_t segment;
+    uint32_t used;
+    uint16_t deltas[LINE_INDEX_SEGMENT_LINES];
+} LineIndexSegment;
+
+struct LineIndex {
+    uint32_t* checkpoints;
+    // LINE_INDEX_BLOCK_MARKS offsets per block, from its checkpoint to segments 1 and up
+    uint16_t* marks;
+    uint32_t checkpoint_capacity;
+    uint32_t count;
+    // Slots of block 0 in front of line 0, left free by lines put in front of the index
+    uint32_t skew;
+    uint32_t origin;
+    uint32_t end;
+
+    LineIndexBlock tail;
+    LineIndexSegment cache[LINE_INDEX_CACHE_SEGMENTS];
+    uint32_t use_counter;
+};
+
+LineIndex* line_index_alloc(void) {
+    LineIndex* index = malloc(sizeof(LineIndex));
+    memset(index, 0, sizeof(LineIndex));
+    line_index_reset(index);
+    return index;
+}
+
+void line_index_free(LineIndex* index) {
+    furi_assert(index);
+    free(index->checkpoints);
+    free(index->marks);
+    free(index);
+}
+
+void line_index_reset(LineIndex* index) {
+    line_index_reset_at(index, 0);
+}
+
+void line_index_reset_at(LineIndex* index, uint32_t origin) {
+    furi_assert(index);
+    index->count = 0;
+    index->skew = 0;
+    index->origin = origin;
+    index->end = origin;
+    index->tail.block = LINE_INDEX_BLOCK_NONE;
+    for(size_t i = 0; i < LINE_INDEX_CACHE_SEGMENTS; i++) {
+        index->cache[i].segment = LINE_INDEX_SEGMENT_NONE;
+        index->cache[i].used = 0;
+    }
+    index->use_counter = 0;
+}
+
+static uint32_t line_index_blocks(const LineIndex* index) {
+    return (index->skew + index->count + LINE_INDEX_BLOCK_LINES - 1) / LINE_INDEX_BLOCK_LINES;
+}
+
+static uint16_t* line_index_mark(const LineIndex* index, uint32_t block, uint32_t segment) {
+    return &index->marks[block * LINE_INDEX_BLOCK_MARKS + segment - 1];
+}
+
+// Drop decoded segments of 'block' whose offsets no longer hold
+static void line_index_forget(LineIndex* index, uint32_t block) {
+    for(size_t i = 0; i < LINE_INDEX_CACHE_SEGMENTS; i++) {
+        LineIndexSegment* entry = &index->cache[i];
+        if(entry->segment / LINE_INDEX_BLOCK_SEGMENTS == block) {
+            entry->segment = LINE_INDEX_SEGMENT_NONE;
+        }
+    }
+}
+
+static bool line_index_reserve(LineIndex* index, uint32_t blocks) {
+    if(blocks <= index->checkpoint_capacity) return true;
+
+    uint32_t capacity = index->checkpoint_capacity + LINE_INDEX_CHECKPOINTS_GROW;
+    if(capacity < blocks) capacity = blocks;
+    uint32_t* checkpoints = realloc(index->checkpoints, capacity * sizeof(uint32_t));
+    if(checkpoints) index->checkpoints = checkpoints;
+    uint16_t* marks =
+        checkpoints ?
+            realloc(index->marks, capacity * LINE_INDEX_BLOCK_MARKS * sizeof(uint16_t)) :
+            NULL;
+    if(!marks) {
+        FURI_LOG_E(TAG, "Out of memory at %lu lines", index->count);
+        return false;
+    }
+    index->marks = marks;
+    index->checkpoint_capacity = capacity;
+    return true;
+}
+
+bool line_index_push(LineIndex* index, uint32_t next_start) {
+    furi_assert(index);
+    furi_assert(next_start > index->end);
+
+    uint32_t position = index->skew + index->count;
+    uint32_t block = position / LINE_INDEX_BLOCK_LINES;
+    uint32_t slot = position % LINE_INDEX_BLOCK_LINES;
+
+    if(slot == 0) {
+        if(!line_index_reserve(index, block + 1)) return false;
+        index->checkpoints[block] = index->end;
+        index->tail.block = block;
+    }
+
+    uint16_t delta = (uint16_t)(index->end - index->checkpoints[block]);
+    index->tail.deltas[slot] = delta;
+    if(slot % LINE_INDEX_SEGMENT_LINES == 0 && slot > 0) {
+        *line_index_mark(index, block, slot / LINE_INDEX_SEGMENT_LINES) = delta;
+    }
+    index->count++;
+    index->end = next_start;
+    return true;
+}
+
+bool line_index_prepend(LineIndex* index, const uint32_t* starts, uint32_t lines) {
+    furi_assert(index);
+    if(lines == 0) return true;
+    furi_assert(starts[lines - 1] < index->origin);
+
+    // Whole blocks are added in front only once the free slots of block 0 run out
+    uint32_t skew = index->skew;
+    uint32_t added = 0;
+    if(lines > skew) {
+        added = (lines - skew + LINE_INDEX_BLOCK_LINES - 1) / LINE_INDEX_BLOCK_LINES;
+    }
+    uint32_t blocks = line_index_blocks(index);
+    if(!line_index_reserve(index, blocks + added)) return false;
+    memmove(index->checkpoints + added, index->checkpoints, blocks * sizeof(uint32_t));
+    memmove(
+        index->marks + added * LINE_INDEX_BLOCK_MARKS,
+        index->marks,
+        blocks * LINE_INDEX_BLOCK_MARKS * sizeof(uint16_t));
+
+    // Old block 0 now starts earlier, at the first of the lines that joined it
+    uint32_t joined = added;
+    uint32_t old_checkpoint = blocks > 0 ? index->checkpoints[joined] : 0;
+    uint32_t new_skew = added * LINE_INDEX_BLOCK_LINES + skew - lines;
+    for(uint32_t i = 0; i < lines; i++) {
+        uint32_t position = new_skew + i;
+        uint32_t block = position / LINE_INDEX_BLOCK_LINES;
+        uint32_t slot = position % LINE_INDEX_BLOCK_LINES;
+        if(i == 0 || slot == 0) {
+            index->checkpoints[block] = starts[i];
+        } else if(slot % LINE_INDEX_SEGMENT_LINES == 0) {
+            *line_index_mark(index, block, slot / LINE_INDEX_SEGMENT_LINES) =
+                (uint16_t)(starts[i] - index->checkpoints[block]);
+        }
+    }
+
+    if(blocks > 0) {
+        uint32_t moved = old_checkpoint - index->checkpoints[joined];
+        // The old first line had no mark of its own, it sat at the checkpoint
+        for(uint32_t segment = 1; segment < LINE_INDEX_BLOCK_SEGMENTS; segment++) {
+            uint32_t slot = segment * LINE_INDEX_SEGMENT_LINES;
+            uint16_t* mark = line_index_mark(index, joined, segment);
+            if(slot == skew) {
+                *mark = (uint16_t)moved;
+            } else if(slot > skew) {
+                *mark += moved;
+            }
+        }
+
+        if(index->tail.block == 0) {
+            uint32_t first = joined * LINE_INDEX_BLOCK_LINES;
+            uint32_t used = (skew + index->count - 1) % LINE_INDEX_BLOCK_LINES + 1;
+            for(uint32_t slot = skew; slot < used; slot++) {
+                index->tail.deltas[slot] += moved;
+            }
+            for(uint32_t i = 0; i < lines; i++) {
+                uint32_t position = new_skew + i;
+                if(position >= first) {
+                    index->tail.deltas[position - first] =
+                        (uint16_t)(starts[i] - index->checkpoints[joined]);
+                }
+            }
+        }
+    }
+    if(index->tail.block != LINE_INDEX_BLOCK_NONE) index->tail.block += added;
+    // Segments of the old block 0 were decoded against its old checkpoint
+    line_index_forget(index, 0);
+    for(size_t i = 0; i < LINE_INDEX_CACHE_SEGMENTS; i++) {
+        LineIndexSegment* entry = &index->cache[i];
+        if(entry->segment != LINE_INDEX_SEGMENT_NONE) {
+            entry->segment += added * LINE_INDEX_BLOCK_SEGMENTS;
+        }
+    }
+
+    index->skew = new_skew;
+    index->count += lines;
+    index->origin = starts[0];
+    return true;
+}
+
+static const uint16_t*
+    line_index_load_segment(LineIndex* index, DocStream* stream, uint32_t segment);
+
+void line_index_pop(LineIndex* index, DocStream* stream) {
+    furi_assert(index);
+    if(index->count == 0) return;
+
+    uint32_t line = index->count - 1;
+    uint32_t position = index->skew + line;
+    uint32_t block = position / LINE_INDEX_BLOCK_LINES;
+    if(index->tail.block != block) {
+        // A full last block restored by line_index_read() is not the tail yet
+        uint32_t first = block == 0 ? index->skew / LINE_INDEX_SEGMENT_LINES : 0;
+        for(uint32_t part = first; part < LINE_INDEX_BLOCK_SEGMENTS; part++) {
+            const uint16_t* deltas = line_index_load_segment(
+                index, stream, block * LINE_INDEX_BLOCK_SEGMENTS + part);
+            memcpy(
+                index->tail.deltas + part * LINE_INDEX_SEGMENT_LINES,
+                deltas,
+                LINE_INDEX_SEGMENT_LINES * sizeof(uint16_t));
+        }
+        index->tail.block = block;
+    }
+    // Decoded copies would keep the old length of the line
+    line_index_forget(index, block);
+
+    uint32_t slot = position % LINE_INDEX_BLOCK_LINES;
+    index->end = index->checkpoints[block] + index->tail.deltas[slot];
+    index->count = line;
+    if(index->count == 0) {
+        // The next push starts block 0 again at its first slot
+        index->skew = 0;
+        index->tail.block = LINE_INDEX_BLOCK_NONE;
+    }
+}
+
+uint32_t line_index_count(const LineIndex* index) {
+    furi_assert(index);
+    return index->count;
+}
+
+uint32_t line_index_origin(const LineIndex* index) {
+    furi_assert(index);
+    return index->origin;
+}
+
+uint32_t line_index_end(const LineIndex* index) {
+    furi_assert(index);
+    return index->end;
+}
+
+// Offsets of the LINE_INDEX_SEGMENT_LINES slots of 'segment' from the checkpoint of its block
+static const uint16_t*
+    line_index_load_segment(LineIndex* index, DocStream* stream, uint32_t segment) {
+    uint32_t block = segment / LINE_INDEX_BLOCK_SEGMENTS;
+    uint32_t part = segment % LINE_INDEX_BLOCK_SEGMENTS;
+    if(index->tail.block == block) {
+        return index->tail.deltas + part * LINE_INDEX_SEGMENT_LINES;
+    }
+
+    LineIndexSegment* victim = &index->cache[0];
+    for(size_t i = 0; i < LINE_INDEX_CACHE_SEGMENTS; i++) {
+        LineIndexSegment* entry = &index->cache[i];
+        if(entry->segment == segment) {
+            entry->used = ++index->use_counter;
+            return entry->deltas;
+        }
+        if(entry->used < victim->used) victim = entry;
+    }
+
+    // Every block but the tail is full, so re-splitting from the first line of the segment
+    // reproduces exactly the offsets that were pushed
+    uint32_t slot = part * LINE_INDEX_SEGMENT_LINES;
+    uint32_t last = slot + LINE_INDEX_SEGMENT_LINES;
+    uint16_t delta = 0;
+    if(block == 0 && slot <= index->skew) {
+        slot = index->skew;
+    } else if(part > 0) {
+        delta = *line_index_mark(index, block, part);
+    }
+    uint32_t base = index->checkpoints[block];
+    uint32_t offset = base + delta;
+    victim->deltas[slot % LINE_INDEX_SEGMENT_LINES] = delta;
+    for(slot++; slot < last; slot++) {
+        offset = doc_stream_next_line(stream, offset);
+        victim->deltas[slot % LINE_INDEX_SEGMENT_LINES] = (uint16_t)(offset - base);
+    }
+
+    victim->segment = segment;
+    victim->used = ++index->use_counter;
+    return victim->deltas;
+}
+
+uint32_t line_index_line_start(LineIndex* index, DocStream* stream, uint32_t line) {
+    furi_assert(index);
+    furi_assert(line < index->count);
+
+    uint32_t position = index->skew + line;
+    const uint16_t* deltas =
+        line_index_load_segment(index, stream, position / LINE_INDEX_SEGMENT_LINES);
+    return index->checkpoints[position / LINE_INDEX_BLOCK_LINES] +
+           deltas[position % LINE_INDEX_SEGMENT_LINES];
+}
+
+uint32_t line_index_line_end(LineIndex* index, DocStream* stream, uint32_t line) {
+    furi_assert(index);
+    if(line + 1 < index->count) {
+        return line_index_line_start(index, stream, line + 1);
+    }
+    return index->end;
+}
+
+uint32_t line_index_find(LineIndex* index, DocStream* stream, uint32_t offset) {
+    furi_assert(index);
+    furi_assert(offset >= index->origin && offset < index->end);
+
+    // Last block whose checkpoint is at or before 'offset'
+    uint32_t low = 0;
+    uint32_t high = line_index_blocks(index);
+    while(high - low > 1) {
+        uint32_t mid = low + (high - low) / 2;
+        if(index->checkpoints[mid] <= offset) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    uint32_t first = low * LINE_INDEX_BLOCK_LINES;
+    uint32_t slots = index->skew + index->count - first;
+    if(slots > LINE_INDEX_BLOCK_LINES) slots = LINE_INDEX_BLOCK_LINES;
+    uint32_t delta = offset - index->checkpoints[low];
+
+    // Then the last of its segments that starts at or before 'offset'
+    uint32_t slot = low == 0 ? index->skew : 0;
+    uint32_t part = slot / LINE_INDEX_SEGMENT_LINES;
+    while((part + 1) * LINE_INDEX_SEGMENT_LINES < slots &&
+          *line_index_mark(index, low, part + 1) <= delta) {
+        part++;
+    }
+    if(part * LINE_INDEX_SEGMENT_LINES > slot) slot = part * LINE_INDEX_SEGMENT_LINES;
+    uint32_t last = (part + 1) * LINE_INDEX_SEGMENT_LINES;
+    if(last > slots) last = slots;
+
+    const uint16_t* deltas =
+        line_index_load_segment(index, stream, low * LINE_INDEX_BLOCK_SEGMENTS + part);
+    while(slot + 1 < last && deltas[(slot + 1) % LINE_INDEX_SEGMENT_LINES] <= delta) {
+        slot++;
+    }
+    return first + slot - index->skew;
+}
+
+bool line_index_write(const LineIndex* index, File* file) {
+    furi_assert(index);
+    if(index->origin != 0) return false;
+    uint32_t header[3] = {index->count, index->end, index->skew};
+    uint32_t blocks = line_index_blocks(index);
+    uint32_t tail_lines = (index->skew + index->count) % LINE_INDEX_BLOCK_LINES;
+
+    if(storage_file_write(file, header, sizeof(header)) != sizeof(header)) return false;
+    size_t size = blocks * sizeof(uint32_t);
+    if(storage_file_write(file, index->checkpoints, size) != size) return false;
+    size = blocks * LINE_INDEX_BLOCK_MARKS * sizeof(uint16_t);
+    if(storage_file_write(file, index->marks, size) != size) return false;
+    size = tail_lines * sizeof(uint16_t);
+    if(storage_file_write(file, index->tail.deltas, size) != size) return false;
+    return true;
+}
+
+bool line_index_read(LineIndex* index, File* file) {
+    furi_assert(index);
+    line_index_reset(index);
+
+    uint32_t header[3];
+    if(storage_file_read(file, header, sizeof(header)) != sizeof(header)) return false;
+
+    uint32_t count = header[0];
+    uint32_t skew = header[2];
+    if(skew >= LINE_INDEX_BLOCK_LINES || (count == 0 && skew > 0)) return false;
+    uint32_t blocks = (skew + count + LINE_INDEX_BLOCK_LINES - 1) / LINE_INDEX_BLOCK_LINES;
+    if(!line_index_reserve(index, blocks)) return false;
+
+    size_t size = blocks * sizeof(uint32_t);
+    if(storage_file_read(file, index->checkpoints, size) != size) return false;
+    size = blocks * LINE_INDEX_BLOCK_MARKS * sizeof(uint16_t);
+    if(storage_file_read(file, index->marks, size) != size) return false;
+    uint32_t tail_lines = (skew + count) % LINE_INDEX_BLOCK_LINES;
+    size = tail_lines * sizeof(uint16_t);
+    if(storage_file_read(file, index->tail.deltas, size) != size) return false;
+
+    index->tail.block = tail_lines ? blocks - 1 : LINE_INDEX_BLOCK_NONE;
+    index->count = count;
+    index->skew = skew;
+    index->end = header[1];
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <furi.h>
+#include "doc_stream.h"
+
+// Lines per block; only the first line of every block is stored as an absolute offset
+#define LINE_INDEX_BLOCK_LINES 64
+// Lines per segment. The first line of every segment is kept as a 16-bit offset into its
+// block, so a lookup outside the cache splits at most LINE_INDEX_SEGMENT_LINES - 1 lines.
+#define LINE_INDEX_SEGMENT_LINES 16
+// Decoded segments kept resident besides the block being appended to
+#define LINE_INDEX_CACHE_SEGMENTS 8
+
+typedef struct LineIndex LineIndex;
+
+LineIndex* line_index_alloc(void);
+void line_index_free(LineIndex* index);
+void line_index_reset(LineIndex* index);
+// Start an empty index at 'origin' instead of the top of the document; line 0 begins there
+void line_index_reset_at(LineIndex* index, uint32_t origin);
+
+// Append the line running from line_index_end() up to 'next_start'.
+// 'next_start' must come from doc_stream_next_line() so blocks can be decoded again.
+bool line_index_push(LineIndex* index, uint32_t next_start);
+
+// Put 'lines' lines in front of line 0, renumbering the others. starts[] holds their offsets
+// in order, each from doc_stream_next_line() of the one before, and the last one must end
+// exactly at line_index_origin().
+bool line_index_prepend(LineIndex* index, const uint32_t* starts, uint32_t lines);
+
+// Remove the last line, so a line that was still being written can be indexed again
+void line_index_pop(LineIndex* index, DocStream* stream);
+
+uint32_t line_index_count(const LineIndex* index);
+// Offset of line 0
+uint32_t line_index_origin(const LineIndex* index);
+// Offset just past the last indexed line, where indexing resumes
+uint32_t line_index_end(const LineIndex* index);
+
+// Byte offset of 'line'; decodes its segment from 'stream' on a cache miss
+uint32_t line_index_line_start(LineIndex* index, DocStream* stream, uint32_t line);
+// Offset where 'line' ends, including its terminator
+uint32_t line_index_line_end(LineIndex* index, DocStream* stream, uint32_t line);
+
+// Line containing byte 'offset', which must lie between line_index_origin() and
+// line_index_end()
+uint32_t line_index_find(LineIndex* index, DocStream* stream, uint32_t offset);
+
+// Serialize the checkpoints, segment offsets and the partially filled tail block to 'file'.
+// Fails for an index that does not start at the top of the document, which a reader could
+// not verify.
+bool line_index_write(const LineIndex* index, File* file);
+// Replace the contents of 'index' with a table written by line_index_write()
+bool line_index_read(LineIndex* index, File* file);
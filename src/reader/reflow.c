@@ -0,0 +1,118 @@
+#include "reflow.h"
+#include "text_scan.h"
+#include <string.h>
+
+#define REFLOW_LINE_NONE UINT32_MAX
+#define REFLOW_CHUNK     64
+
+typedef struct {
+    ReflowLine lines[REFLOW_ENTRIES];
+    uint8_t next;
+} ReflowFont;
+
+struct Reflow {
+    ReflowFont fonts[TEXT_LAYOUT_FONTS];
+};
+
+Reflow* reflow_alloc(void) {
+    Reflow* reflow = malloc(sizeof(Reflow));
+    reflow_reset(reflow);
+    return reflow;
+}
+
+void reflow_free(Reflow* reflow) {
+    furi_assert(reflow);
+    free(reflow);
+}
+
+void reflow_reset(Reflow* reflow) {
+    furi_assert(reflow);
+    for(size_t font = 0; font < TEXT_LAYOUT_FONTS; font++) {
+        for(size_t i = 0; i < REFLOW_ENTRIES; i++) {
+            reflow->fonts[font].lines[i].line = REFLOW_LINE_NONE;
+        }
+        reflow->fonts[font].next = 0;
+    }
+}
+
+const ReflowLine* reflow_lookup(Reflow* reflow, uint8_t slot, uint32_t line) {
+    furi_assert(reflow);
+    furi_assert(slot < TEXT_LAYOUT_FONTS);
+
+    ReflowFont* font = &reflow->fonts[slot];
+    for(size_t i = 0; i < REFLOW_ENTRIES; i++) {
+        if(font->lines[i].line == line) return &font->lines[i];
+    }
+    return NULL;
+}
+
+const ReflowLine* reflow_wrap(
+    Reflow* reflow,
+    uint8_t slot,
+    uint32_t line,
+    DocStream* stream,
+    uint32_t start,
+    uint32_t length,
+    const uint8_t* advance,
+    bool binary,
+    uint32_t width) {
+    furi_assert(reflow);
+    furi_assert(slot < TEXT_LAYOUT_FONTS);
+
+    ReflowFont* font = &reflow->fonts[slot];
+    ReflowLine* entry = (ReflowLine*)reflow_lookup(reflow, slot, line);
+    if(!entry) {
+        entry = &font->lines[font->next];
+        font->next = (font->next + 1) % REFLOW_ENTRIES;
+    }
+
+    entry->line = line;
+    entry->length = length;
+    entry->rows = 1;
+    entry->row_start[0] = 0;
+
+    uint8_t chunk[REFLOW_CHUNK];
+    uint32_t row_width = 0;
+    uint32_t break_width = 0;
+    uint16_t break_pos = 0;
+
+    for(uint32_t pos = 0; pos < length;) {
+        size_t count = length - pos < REFLOW_CHUNK ? length - pos : REFLOW_CHUNK;
+        count = doc_stream_read(stream, start + pos, chunk, count);
+        if(count == 0) break;
+        if(binary) text_scan_clean(chunk, count);
+
+        for(size_t i = 0; i < count; i++, pos++) {
+            uint8_t glyph = advance[chunk[i]];
+            uint16_t row_begin = entry->row_start[entry->rows - 1];
+
+            if(row_width + glyph > width && pos > row_begin) {
+                if(entry->rows == REFLOW_ROWS_MAX) {
+                    // Anything past the last row is clipped instead of wrapped
+                    return entry;
+                }
+                if(break_pos > row_begin) {
+                    entry->row_start[entry->rows++] = break_pos;
+                    row_width -= break_width;
+                } else {
+                    entry->row_start[entry->rows++] = (uint16_t)pos;
+                    row_width = 0;
+                }
+            }
+
+            row_width += glyph;
+            if(chunk[i] == ' ' || chunk[i] == '\t') {
+                break_pos = (uint16_t)(pos + 1);
+                break_width = row_width;
+            }
+        }
+    }
+
+    return entry;
+}
+
+uint32_t reflow_row_length(const ReflowLine* entry, uint8_t row) {
+    furi_assert(row < entry->rows);
+    uint32_t end = row + 1 < entry->rows ? entry->row_start[row + 1] : entry->length;
+    return end - entry->row_start[row];
+}
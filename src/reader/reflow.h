@@ -0,0 +1,44 @@
+#pragma once
+
+#include <furi.h>
+#include "doc_stream.h"
+#include "text_layout.h"
+
+// Wrapped lines kept per font; one page never shows more logical lines than this
+#define REFLOW_ENTRIES  8
+#define REFLOW_ROWS_MAX 64
+
+// Visual rows of one logical line, as byte offsets from the start of the line
+typedef struct {
+    uint32_t line;
+    uint32_t length;
+    uint8_t rows;
+    uint16_t row_start[REFLOW_ROWS_MAX];
+} ReflowLine;
+
+typedef struct Reflow Reflow;
+
+Reflow* reflow_alloc(void);
+void reflow_free(Reflow* reflow);
+
+// Forget every wrapped line in every font
+void reflow_reset(Reflow* reflow);
+
+// Rows of 'line' in font 'slot' if that line was wrapped before, or NULL
+const ReflowLine* reflow_lookup(Reflow* reflow, uint8_t slot, uint32_t line);
+
+// Wrap the 'length' bytes at 'start' into rows of at most 'width' pixels, breaking after
+// spaces where possible, and cache the result for 'slot'
+const ReflowLine* reflow_wrap(
+    Reflow* reflow,
+    uint8_t slot,
+    uint32_t line,
+    DocStream* stream,
+    uint32_t start,
+    uint32_t length,
+    const uint8_t* advance,
+    bool binary,
+    uint32_t width);
+
+// Length in bytes of 'row' of 'entry'
+uint32_t reflow_row_length(const ReflowLine* entry, uint8_t row);
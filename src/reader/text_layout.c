@@ -0,0 +1,124 @@
+#include "text_layout.h"
+#include <string.h>
+
+#define TEXT_LAYOUT_LINE_NONE UINT32_MAX
+
+typedef struct {
+    bool ready;
+    Font font;
+    uint8_t advance[256];
+} GlyphTable;
+
+struct TextLayout {
+    GlyphTable glyphs[TEXT_LAYOUT_FONTS];
+    uint8_t slot;
+
+    TextLayoutEntry entries[TEXT_LAYOUT_ENTRIES];
+    uint8_t next_entry;
+
+    uint32_t hits;
+    uint32_t misses;
+};
+
+TextLayout* text_layout_alloc(void) {
+    TextLayout* layout = malloc(sizeof(TextLayout));
+    memset(layout, 0, sizeof(TextLayout));
+    text_layout_reset(layout);
+    return layout;
+}
+
+void text_layout_free(TextLayout* layout) {
+    furi_assert(layout);
+    free(layout);
+}
+
+void text_layout_reset(TextLayout* layout) {
+    furi_assert(layout);
+    for(size_t i = 0; i < TEXT_LAYOUT_ENTRIES; i++) {
+        layout->entries[i].line = TEXT_LAYOUT_LINE_NONE;
+    }
+    layout->next_entry = 0;
+}
+
+void text_layout_set_font(TextLayout* layout, Canvas* canvas, uint8_t slot, Font font) {
+    furi_assert(layout);
+    furi_assert(slot < TEXT_LAYOUT_FONTS);
+
+    canvas_set_font(canvas, font);
+    layout->slot = slot;
+
+    GlyphTable* table = &layout->glyphs[slot];
+    if(table->ready && table->font == font) return;
+
+    // Measured once per font; every later width is a table lookup
+    for(size_t c = 0; c < 256; c++) {
+        table->advance[c] = (uint8_t)canvas_glyph_width(canvas, (uint16_t)c);
+    }
+    table->font = font;
+    table->ready = true;
+}
+
+const uint8_t* text_layout_advances(const TextLayout* layout, uint8_t slot) {
+    furi_assert(layout);
+    furi_assert(slot < TEXT_LAYOUT_FONTS);
+    return layout->glyphs[slot].ready ? layout->glyphs[slot].advance : NULL;
+}
+
+uint32_t text_layout_width(TextLayout* layout, const char* text, size_t length) {
+    const uint8_t* advance = layout->glyphs[layout->slot].advance;
+    uint32_t width = 0;
+    for(size_t i = 0; i < length; i++) {
+        width += advance[(uint8_t)text[i]];
+    }
+    return width;
+}
+
+size_t text_layout_clip(TextLayout* layout, const char* text, size_t length, uint32_t max_width) {
+    const uint8_t* advance = layout->glyphs[layout->slot].advance;
+    uint32_t width = 0;
+    size_t i = 0;
+    for(; i < length && width < max_width; i++) {
+        width += advance[(uint8_t)text[i]];
+    }
+    return i;
+}
+
+const TextLayoutEntry* text_layout_lookup(TextLayout* layout, uint32_t line, size_t h_offset) {
+    furi_assert(layout);
+    for(size_t i = 0; i < TEXT_LAYOUT_ENTRIES; i++) {
+        const TextLayoutEntry* entry = &layout->entries[i];
+        if(entry->line != line || entry->font != layout->slot) continue;
+        if(entry->is_long && entry->h_offset != h_offset) break;
+        layout->hits++;
+        return entry;
+    }
+    layout->misses++;
+    return NULL;
+}
+
+TextLayoutEntry* text_layout_store(TextLayout* layout, uint32_t line) {
+    furi_assert(layout);
+
+    TextLayoutEntry* entry = NULL;
+    for(size_t i = 0; i < TEXT_LAYOUT_ENTRIES && !entry; i++) {
+        if(layout->entries[i].line == line && layout->entries[i].font == layout->slot) {
+            entry = &layout->entries[i];
+        }
+    }
+    if(!entry) {
+        entry = &layout->entries[layout->next_entry];
+        layout->next_entry = (layout->next_entry + 1) % TEXT_LAYOUT_ENTRIES;
+    }
+
+    memset(entry, 0, sizeof(TextLayoutEntry));
+    entry->line = line;
+    entry->font = layout->slot;
+    return entry;
+}
+
+uint8_t text_layout_hit_rate(const TextLayout* layout) {
+    furi_assert(layout);
+    uint32_t total = layout->hits + layout->misses;
+    if(total == 0) return 0;
+    return (uint8_t)((uint64_t)layout->hits * 100 / total);
+}
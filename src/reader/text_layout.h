@@ -0,0 +1,48 @@
+#pragma once
+
+#include <furi.h>
+#include <gui/canvas.h>
+
+#define TEXT_LAYOUT_FONTS    2
+#define TEXT_LAYOUT_ENTRIES  8
+#define TEXT_LAYOUT_SPAN_MAX 64
+
+// A line already measured and clipped to the screen width
+typedef struct {
+    uint32_t line;
+    uint8_t font;
+    size_t h_offset; // First byte shown; always 0 unless the line is long
+    uint32_t line_length;
+    bool is_long; // Wider than the screen, so h_offset applies
+    uint8_t span_length;
+    char span[TEXT_LAYOUT_SPAN_MAX + 1];
+} TextLayoutEntry;
+
+typedef struct TextLayout TextLayout;
+
+TextLayout* text_layout_alloc(void);
+void text_layout_free(TextLayout* layout);
+
+// Forget all cached lines, e.g. when the document or its index changes
+void text_layout_reset(TextLayout* layout);
+
+// Select 'font' on the canvas; 'slot' picks its glyph table (< TEXT_LAYOUT_FONTS)
+void text_layout_set_font(TextLayout* layout, Canvas* canvas, uint8_t slot, Font font);
+
+// Glyph advances of font 'slot', or NULL until that font has been drawn once
+const uint8_t* text_layout_advances(const TextLayout* layout, uint8_t slot);
+
+// Width in pixels of 'text' in the font selected by text_layout_set_font()
+uint32_t text_layout_width(TextLayout* layout, const char* text, size_t length);
+
+// Number of leading bytes of 'text' that start within 'max_width' pixels
+size_t text_layout_clip(TextLayout* layout, const char* text, size_t length, uint32_t max_width);
+
+// Cached layout of 'line' in the current font when shown at 'h_offset', or NULL
+const TextLayoutEntry* text_layout_lookup(TextLayout* layout, uint32_t line, size_t h_offset);
+
+// Slot to fill for 'line' in the current font, evicting the oldest entry
+TextLayoutEntry* text_layout_store(TextLayout* layout, uint32_t line);
+
+// Percentage of lookups served from the cache since allocation
+uint8_t text_layout_hit_rate(const TextLayout* layout);
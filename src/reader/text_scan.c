@@ -0,0 +1,133 @@
+#include "text_scan.h"
+#include <stdbool.h>
+#include <string.h>
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "text_scan assumes a little-endian target"
+#endif
+
+typedef size_t TextWord;
+
+#define WORD_SIZE  sizeof(TextWord)
+#define WORD_ONES  ((TextWord)-1 / 0xFF) // 0x0101...
+#define WORD_HIGHS (WORD_ONES * 0x80) // 0x8080...
+#define WORD_LOWS  (WORD_ONES * 0x7F) // 0x7F7F...
+
+// The masks below are exact: the high bit of each byte is set only for bytes
+// that match, and the additions never carry into the neighbouring byte.
+
+static inline TextWord word_eq_zero(TextWord v) {
+    return ~(((v & WORD_LOWS) + WORD_LOWS) | v | WORD_LOWS);
+}
+
+static inline TextWord word_eq(TextWord v, uint8_t c) {
+    return word_eq_zero(v ^ (WORD_ONES * c));
+}
+
+static inline TextWord word_below(TextWord v, uint8_t n) {
+    return ~(((v & WORD_LOWS) + WORD_ONES * (0x80 - n)) | v) & WORD_HIGHS;
+}
+
+static inline TextWord word_above_126(TextWord v) {
+    return (((v & WORD_LOWS) + WORD_ONES) | v) & WORD_HIGHS;
+}
+
+static inline TextWord word_binary(TextWord v) {
+    TextWord whitespace = word_eq(v, '\t') | word_eq(v, '\n') | word_eq(v, '\r');
+    TextWord control = word_below(v, 32) & ~whitespace;
+    return control | word_above_126(v);
+}
+
+static inline bool byte_is_binary(uint8_t c) {
+    return (c < 32 || c > 126) && c != '\t' && c != '\n' && c != '\r';
+}
+
+static inline TextWord word_load(const uint8_t* data) {
+    TextWord v;
+    memcpy(&v, data, WORD_SIZE);
+    return v;
+}
+
+static inline size_t word_first_byte(TextWord mask) {
+    if(WORD_SIZE == 8) return (size_t)__builtin_ctzll((unsigned long long)mask) / 8;
+    return (size_t)__builtin_ctz((unsigned int)mask) / 8;
+}
+
+static inline size_t word_count_bytes(TextWord mask) {
+    // One bit per matching byte, summed into the top byte by the multiply
+    return (size_t)((((mask >> 7) * WORD_ONES)) >> (WORD_SIZE * 8 - 8));
+}
+
+static inline size_t head_length(const uint8_t* data, size_t size) {
+    size_t head = (WORD_SIZE - ((uintptr_t)data % WORD_SIZE)) % WORD_SIZE;
+    return head < size ? head : size;
+}
+
+size_t text_scan_newline(const uint8_t* data, size_t size) {
+    size_t i = 0;
+    for(size_t head = head_length(data, size); i < head; i++) {
+        if(data[i] == '\n') return i;
+    }
+    for(; i + WORD_SIZE <= size; i += WORD_SIZE) {
+        TextWord mask = word_eq(word_load(data + i), '\n');
+        if(mask) return i + word_first_byte(mask);
+    }
+    for(; i < size; i++) {
+        if(data[i] == '\n') return i;
+    }
+    return size;
+}
+
+size_t text_scan_count_binary(const uint8_t* data, size_t size) {
+    size_t count = 0;
+    size_t i = 0;
+    for(size_t head = head_length(data, size); i < head; i++) {
+        count += byte_is_binary(data[i]);
+    }
+    for(; i + WORD_SIZE <= size; i += WORD_SIZE) {
+        count += word_count_bytes(word_binary(word_load(data + i)));
+    }
+    for(; i < size; i++) {
+        count += byte_is_binary(data[i]);
+    }
+    return count;
+}
+
+void text_scan_clean(uint8_t* data, size_t size) {
+    size_t i = 0;
+    for(size_t head = head_length(data, size); i < head; i++) {
+        if(byte_is_binary(data[i])) data[i] = '.';
+    }
+    for(; i + WORD_SIZE <= size; i += WORD_SIZE) {
+        TextWord v = word_load(data + i);
+        TextWord mask = word_binary(v);
+        if(!mask) continue;
+        TextWord bytes = (mask >> 7) * 0xFF;
+        v = (v & ~bytes) | ((WORD_ONES * '.') & bytes);
+        memcpy(data + i, &v, WORD_SIZE);
+    }
+    for(; i < size; i++) {
+        if(byte_is_binary(data[i])) data[i] = '.';
+    }
+}
+
+size_t text_scan_newline_ref(const uint8_t* data, size_t size) {
+    for(size_t i = 0; i < size; i++) {
+        if(data[i] == '\n') return i;
+    }
+    return size;
+}
+
+size_t text_scan_count_binary_ref(const uint8_t* data, size_t size) {
+    size_t count = 0;
+    for(size_t i = 0; i < size; i++) {
+        count += byte_is_binary(data[i]);
+    }
+    return count;
+}
+
+void text_scan_clean_ref(uint8_t* data, size_t size) {
+    for(size_t i = 0; i < size; i++) {
+        if(byte_is_binary(data[i])) data[i] = '.';
+    }
+}
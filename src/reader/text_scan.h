@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Word-at-a-time (SWAR) text kernels. They process one size_t per step, which is
+// 32 bits on the Cortex-M4 and 64 bits on a host build.
+
+// Index of the first '\n' in 'data', or 'size' if there is none
+size_t text_scan_newline(const uint8_t* data, size_t size);
+
+// Number of bytes outside printable ASCII, not counting '\t', '\n' and '\r'
+size_t text_scan_count_binary(const uint8_t* data, size_t size);
+
+// Replace every byte counted by text_scan_count_binary() with '.'
+void text_scan_clean(uint8_t* data, size_t size);
+
+// Byte-at-a-time references the SWAR kernels must agree with
+size_t text_scan_newline_ref(const uint8_t* data, size_t size);
+size_t text_scan_count_binary_ref(const uint8_t* data, size_t size);
+void text_scan_clean_ref(uint8_t* data, size_t size);
@@ -0,0 +1,29 @@
+#pragma once
+
+// fbs.c keeps its state in statics, so the link tests build it once per end of the link.
+// With FBS_END defined, its public calls and the serial profile calls it makes are renamed
+// with that prefix, e.g. sender_fbs_send_file() and sender_ble_profile_serial_tx().
+
+#include <stdbool.h>
+
+#define FBS_END_NAME(end, name)  FBS_END_PASTE(end, name)
+#define FBS_END_PASTE(end, name) end##_##name
+
+#ifdef FBS_END
+#define fbs_init           FBS_END_NAME(FBS_END, fbs_init)
+#define fbs_is_connected   FBS_END_NAME(FBS_END, fbs_is_connected)
+#define fbs_send_file      FBS_END_NAME(FBS_END, fbs_send_file)
+#define fbs_receive_file   FBS_END_NAME(FBS_END, fbs_receive_file)
+#define fbs_get_frames     FBS_END_NAME(FBS_END, fbs_get_frames)
+#define fbs_get_throughput FBS_END_NAME(FBS_END, fbs_get_throughput)
+#define fbs_get_retries    FBS_END_NAME(FBS_END, fbs_get_retries)
+#define fbs_deinit         FBS_END_NAME(FBS_END, fbs_deinit)
+
+#define ble_profile_serial_init   FBS_END_NAME(FBS_END, ble_profile_serial_init)
+#define ble_profile_serial_deinit FBS_END_NAME(FBS_END, ble_profile_serial_deinit)
+#define ble_profile_serial_tx     FBS_END_NAME(FBS_END, ble_profile_serial_tx)
+#define ble_profile_serial_set_connection_callbacks \
+    FBS_END_NAME(FBS_END, ble_profile_serial_set_connection_callbacks)
+#define ble_profile_serial_set_event_callback \
+    FBS_END_NAME(FBS_END, ble_profile_serial_set_event_callback)
+#endif
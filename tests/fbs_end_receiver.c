@@ -0,0 +1,4 @@
+// fbs.c as the receiver end of the simulated link
+#define FBS_END receiver
+#include "fbs_end.h"
+#include "../src/ble/fbs.c"
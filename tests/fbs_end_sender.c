@@ -0,0 +1,4 @@
+// fbs.c as the sender end of the simulated link
+#define FBS_END sender
+#include "fbs_end.h"
+#include "../src/ble/fbs.c"
@@ -0,0 +1,320 @@
+#include "fbs_link.h"
+#include "test.h"
+
+#define FBS_LINK_QUEUE_SIZE 8
+// How long a sender waits for the receiver to return after a pass over the whole file
+#define FBS_LINK_SETTLE_MS 200
+
+struct BleProfileSerial {
+    FbsLinkEnd end;
+    BleProfileSerialConnectionCallback on_connect;
+    BleProfileSerialConnectionCallback on_disconnect;
+    void* connection_context;
+    SerialServiceEventCallback on_event;
+    void* event_context;
+};
+
+typedef struct {
+    bool stop; // Posted by fbs_link_close() to end the delivery thread
+    uint32_t due_tick;
+    uint16_t size;
+    uint8_t data[BLE_PROFILE_SERIAL_PACKET_SIZE_MAX];
+} FbsLinkFrame;
+
+// Frames from one end wait in its queue until a thread delivers them to the other end
+typedef struct {
+    BleProfileSerial profile;
+    bool registered;
+    FuriMessageQueue* queue;
+    FuriThread* thread;
+    uint32_t random;
+    uint32_t refuse_random; // Drawn by the transmitting thread, 'random' by the delivering one
+    FbsLinkStats stats;
+} FbsLinkDirection;
+
+// Both ends share one link at a time
+static struct {
+    FbsLinkConfig config;
+    FbsLinkDirection from[FbsLinkEnds];
+    volatile bool connected;
+    volatile bool closing;
+} channel;
+
+static struct {
+    const char* folder;
+    FuriString* path;
+    FuriThread* thread;
+    FuriSemaphore* ready; // Given on the first progress poll, once frames are taken
+    FuriSemaphore* done;
+    FuriSemaphore* held; // Given when the receiver parks in its progress poll
+    volatile bool hold;
+    volatile bool stop;
+    bool finished;
+    bool ok;
+} receive;
+
+static BleProfileSerial* fbs_link_register(FbsLinkEnd end) {
+    FbsLinkDirection* direction = &channel.from[end];
+    furi_check(!direction->registered);
+    direction->registered = true;
+    memset(&direction->profile, 0, sizeof(direction->profile));
+    direction->profile.end = end;
+    return &direction->profile;
+}
+
+static void fbs_link_deliver(FbsLinkDirection* direction, FbsLinkFrame* frame) {
+    FbsLinkDirection* peer = &channel.from[direction == &channel.from[FbsLinkSender]];
+    uint32_t roll = test_random(&direction->random) % 1000;
+
+    if(roll < channel.config.drop_permille) {
+        direction->stats.dropped++;
+    } else {
+        if(roll < channel.config.drop_permille + channel.config.corrupt_permille) {
+            uint32_t bit = test_random(&direction->random) % (frame->size * 8u);
+            frame->data[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+            direction->stats.corrupted++;
+        }
+        if(peer->profile.on_event) {
+            SerialServiceEvent event = {
+                .event = SerialServiceEventTypeDataReceived,
+                .data = {.buffer = frame->data, .size = frame->size},
+            };
+            peer->profile.on_event(event, peer->profile.event_context);
+        }
+    }
+
+    direction->stats.delivered++;
+
+    // The stack confirms every indication it got out; losses happen above it
+    if(direction->profile.on_event) {
+        SerialServiceEvent event = {.event = SerialServiceEventTypeDataSent};
+        direction->profile.on_event(event, direction->profile.event_context);
+    }
+}
+
+static int32_t fbs_link_thread(void* context) {
+    FbsLinkDirection* direction = context;
+    FbsLinkFrame frame;
+
+    for(;;) {
+        furi_message_queue_get(direction->queue, &frame, FuriWaitForever);
+        if(frame.stop) break;
+        int32_t wait = (int32_t)(frame.due_tick - furi_get_tick());
+        if(wait > 0) furi_delay_ms((uint32_t)wait);
+        if(!channel.closing) fbs_link_deliver(direction, &frame);
+    }
+
+    return 0;
+}
+
+void fbs_link_open(const FbsLinkConfig* config) {
+    memset(&channel, 0, sizeof(channel));
+    channel.config = *config;
+    for(size_t end = 0; end < FbsLinkEnds; end++) {
+        FbsLinkDirection* direction = &channel.from[end];
+        direction->random = config->seed * 2 + (uint32_t)end + 1;
+        direction->refuse_random = direction->random + FbsLinkEnds;
+        direction->queue = furi_message_queue_alloc(FBS_LINK_QUEUE_SIZE, sizeof(FbsLinkFrame));
+        direction->thread = furi_thread_alloc_ex("FbsLink", 1024, fbs_link_thread, direction);
+        furi_thread_start(direction->thread);
+    }
+}
+
+void fbs_link_connect(void) {
+    channel.connected = true;
+    for(size_t end = 0; end < FbsLinkEnds; end++) {
+        BleProfileSerial* profile = &channel.from[end].profile;
+        if(profile->on_connect) profile->on_connect(profile->connection_context);
+    }
+}
+
+void fbs_link_close(void) {
+    channel.connected = false;
+    channel.closing = true;
+    for(size_t end = 0; end < FbsLinkEnds; end++) {
+        BleProfileSerial* profile = &channel.from[end].profile;
+        if(profile->on_disconnect) profile->on_disconnect(profile->connection_context);
+    }
+
+    FbsLinkFrame stop = {.stop = true};
+    for(size_t end = 0; end < FbsLinkEnds; end++) {
+        FbsLinkDirection* direction = &channel.from[end];
+        furi_message_queue_put(direction->queue, &stop, FuriWaitForever);
+        furi_thread_join(direction->thread);
+        furi_thread_free(direction->thread);
+        furi_message_queue_free(direction->queue);
+    }
+}
+
+FbsLinkStats fbs_link_stats(FbsLinkEnd from) {
+    return channel.from[from].stats;
+}
+
+BleProfileSerial* fbs_link_profile(FbsLinkEnd end) {
+    furi_check(channel.from[end].registered);
+    return &channel.from[end].profile;
+}
+
+static bool fbs_link_receive_callback(uint32_t sent, uint32_t total, void* context) {
+    UNUSED(sent);
+    UNUSED(total);
+    UNUSED(context);
+    if(receive.ready) furi_semaphore_release(receive.ready);
+    if(receive.hold) {
+        furi_semaphore_release(receive.held);
+        while(receive.hold && !receive.stop) {
+            furi_delay_ms(1);
+        }
+    }
+    return !receive.stop;
+}
+
+static int32_t fbs_link_receive_thread(void* context) {
+    UNUSED(context);
+    receive.ok = receiver_fbs_receive_file(
+        receive.folder, receive.path, fbs_link_receive_callback, NULL);
+    furi_semaphore_release(receive.done);
+    return 0;
+}
+
+void fbs_link_receive_start(const char* folder, FuriString* path) {
+    furi_check(!receive.thread);
+    receive.folder = folder;
+    receive.path = path;
+    receive.stop = false;
+    receive.hold = false;
+    receive.finished = false;
+    receive.ok = false;
+    receive.ready = furi_semaphore_alloc(1, 0);
+    receive.done = furi_semaphore_alloc(1, 0);
+    receive.held = furi_semaphore_alloc(1, 0);
+    receive.thread = furi_thread_alloc_ex("FbsLinkRx", 2048, fbs_link_receive_thread, NULL);
+    furi_thread_start(receive.thread);
+    furi_semaphore_acquire(receive.ready, FuriWaitForever);
+}
+
+bool fbs_link_receive_wait(uint32_t timeout_ms) {
+    if(!receive.finished) {
+        receive.finished = furi_semaphore_acquire(receive.done, timeout_ms) == FuriStatusOk;
+    }
+    return receive.finished;
+}
+
+bool fbs_link_receive_hold(bool hold) {
+    if(!hold) {
+        receive.hold = false;
+        return true;
+    }
+    furi_semaphore_acquire(receive.held, 0);
+    receive.hold = true;
+    // A receiver that already returned never polls again
+    while(furi_semaphore_acquire(receive.held, 10) != FuriStatusOk) {
+        if(fbs_link_receive_wait(0)) {
+            receive.hold = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool fbs_link_receive_stop(void) {
+    receive.stop = true;
+    furi_thread_join(receive.thread);
+    furi_thread_free(receive.thread);
+    receive.thread = NULL;
+    furi_semaphore_free(receive.done);
+    furi_semaphore_free(receive.held);
+    furi_semaphore_free(receive.ready);
+    receive.ready = NULL;
+    return receive.ok;
+}
+
+uint32_t fbs_link_send_until_received(const char* path, bool compress, uint32_t max_attempts) {
+    uint32_t attempts = 0;
+    while(attempts < max_attempts) {
+        attempts++;
+        sender_fbs_send_file(path, compress, NULL, NULL);
+        // The end frame and its confirmation are still on the way
+        if(fbs_link_receive_wait(FBS_LINK_SETTLE_MS + 4 * channel.config.latency_ms)) break;
+    }
+    return attempts;
+}
+
+static bool fbs_link_tx(BleProfileSerial* profile, uint8_t* data, uint16_t size) {
+    furi_check(size > 0 && size <= BLE_PROFILE_SERIAL_PACKET_SIZE_MAX);
+    if(!channel.connected) return false;
+
+    FbsLinkDirection* direction = &channel.from[profile->end];
+    if(test_random(&direction->refuse_random) % 1000 < channel.config.refuse_permille) {
+        direction->stats.refused++;
+        return false;
+    }
+    FbsLinkFrame frame = {
+        .due_tick = furi_get_tick() + channel.config.latency_ms,
+        .size = size,
+    };
+    memcpy(frame.data, data, size);
+    // Like the stack, refuse rather than wait when too much is already on the way
+    bool queued = furi_message_queue_put(direction->queue, &frame, 0) == FuriStatusOk;
+    if(queued) {
+        direction->stats.frames++;
+        direction->stats.bytes += size;
+    }
+    return queued;
+}
+
+static void fbs_link_set_connection_callbacks(
+    BleProfileSerial* profile,
+    BleProfileSerialConnectionCallback on_connect,
+    BleProfileSerialConnectionCallback on_disconnect,
+    void* context) {
+    profile->on_connect = on_connect;
+    profile->on_disconnect = on_disconnect;
+    profile->connection_context = context;
+}
+
+static void fbs_link_set_event_callback(
+    BleProfileSerial* profile,
+    uint16_t buffer_size,
+    SerialServiceEventCallback callback,
+    void* context) {
+    UNUSED(buffer_size);
+    profile->on_event = callback;
+    profile->event_context = context;
+}
+
+static void fbs_link_unregister(BleProfileSerial* profile) {
+    FbsLinkDirection* direction = &channel.from[profile->end];
+    direction->registered = false;
+    memset(&direction->profile, 0, sizeof(direction->profile));
+}
+
+// The serial profile as each end's build of fbs.c calls it
+#define FBS_LINK_DEFINE_END(end, id)                                                    \
+    BleProfileSerial* end##_ble_profile_serial_init(void) {                             \
+        return fbs_link_register(id);                                                   \
+    }                                                                                   \
+    void end##_ble_profile_serial_deinit(BleProfileSerial* profile) {                   \
+        fbs_link_unregister(profile);                                                   \
+    }                                                                                   \
+    bool end##_ble_profile_serial_tx(                                                   \
+        BleProfileSerial* profile, uint8_t* data, uint16_t size) {                      \
+        return fbs_link_tx(profile, data, size);                                        \
+    }                                                                                   \
+    void end##_ble_profile_serial_set_connection_callbacks(                             \
+        BleProfileSerial* profile,                                                      \
+        BleProfileSerialConnectionCallback on_connect,                                  \
+        BleProfileSerialConnectionCallback on_disconnect,                               \
+        void* context) {                                                                \
+        fbs_link_set_connection_callbacks(profile, on_connect, on_disconnect, context); \
+    }                                                                                   \
+    void end##_ble_profile_serial_set_event_callback(                                   \
+        BleProfileSerial* profile,                                                      \
+        uint16_t buffer_size,                                                           \
+        SerialServiceEventCallback callback,                                            \
+        void* context) {                                                                \
+        fbs_link_set_event_callback(profile, buffer_size, callback, context);           \
+    }
+
+FBS_LINK_DEFINE_END(sender, FbsLinkSender)
+FBS_LINK_DEFINE_END(receiver, FbsLinkReceiver)
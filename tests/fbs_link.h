@@ -0,0 +1,70 @@
+#pragma once
+
+// An in-memory BLE link between two builds of fbs.c, one per end (see fbs_end.h). Frames
+// arrive after a delay and may be dropped or corrupted on the way, so the frame CRCs and
+// the resume path get exercised.
+
+#include "ble/fbs.h"
+
+typedef enum {
+    FbsLinkSender,
+    FbsLinkReceiver,
+    FbsLinkEnds,
+} FbsLinkEnd;
+
+typedef struct {
+    uint32_t latency_ms; // From transmit to delivery, slept rather than spun
+    uint32_t drop_permille; // Frames lost after the stack confirmed them
+    uint32_t corrupt_permille; // Frames delivered with one bit flipped
+    uint32_t refuse_permille; // Frames the stack refuses to queue, as when it is busy
+    uint32_t seed;
+} FbsLinkConfig;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t dropped;
+    uint32_t corrupted;
+    uint32_t refused;
+    uint32_t delivered; // Frames off the link: handed to the other end, dropped or corrupted
+} FbsLinkStats;
+
+// Open the link; the ends then register through fbs_init() and wait for fbs_link_connect()
+void fbs_link_open(const FbsLinkConfig* config);
+void fbs_link_connect(void);
+// Disconnect and throw away whatever is still on the way
+void fbs_link_close(void);
+// Frames sent by one end so far
+FbsLinkStats fbs_link_stats(FbsLinkEnd from);
+
+#define FBS_LINK_DECLARE_END(end)                                                          \
+    bool end##_fbs_init(void);                                                             \
+    bool end##_fbs_send_file(                                                              \
+        const char* path, bool compress, FbsProgressCallback callback, void* context);     \
+    bool end##_fbs_receive_file(                                                           \
+        const char* folder, FuriString* path, FbsProgressCallback callback, void* context); \
+    uint32_t end##_fbs_get_frames(void);                                                   \
+    uint32_t end##_fbs_get_throughput(void);                                               \
+    uint32_t end##_fbs_get_retries(void);                                                  \
+    void end##_fbs_deinit(void);                                                           \
+    bool end##_ble_profile_serial_tx(BleProfileSerial* profile, uint8_t* data, uint16_t size);
+
+FBS_LINK_DECLARE_END(sender)
+FBS_LINK_DECLARE_END(receiver)
+
+// Run the receiver's fbs_receive_file() into 'folder' on a thread of its own
+void fbs_link_receive_start(const char* folder, FuriString* path);
+// Whether the receiver returned within 'timeout_ms'
+bool fbs_link_receive_wait(uint32_t timeout_ms);
+// Park the receiver's thread in its next progress poll, so frames only queue up behind it,
+// or let it go again. Returns false if the receiver has already returned.
+bool fbs_link_receive_hold(bool hold);
+// Stop the receiver if it is still waiting and return what fbs_receive_file() returned
+bool fbs_link_receive_stop(void);
+
+// Send 'path' again and again, each time resuming where the receiver left off, until the
+// receiver returns or 'max_attempts' have been sent. Returns the attempts made.
+uint32_t fbs_link_send_until_received(const char* path, bool compress, uint32_t max_attempts);
+
+// The profile handle each end got from fbs_init(), to send crafted frames as that end
+BleProfileSerial* fbs_link_profile(FbsLinkEnd end);
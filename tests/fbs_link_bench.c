@@ -0,0 +1,111 @@
+// Transfer throughput of fbs.c over the simulated link, plain and compressed, clean and
+// lossy. Link latency is slept, so cpu_ms is the work both ends actually did.
+
+#include "test.h"
+#include "fbs_link.h"
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FILE_SIZE (128 * 1024)
+
+static char folder[] = "/tmp/fbs_bench_XXXXXX";
+static char source[64];
+static char received_folder[64];
+
+typedef struct {
+    const char* name;
+    bool compress;
+    FbsLinkConfig config;
+} Scenario;
+
+#define CLEAN {.latency_ms = 2}
+#define LOSSY {.latency_ms = 2, .drop_permille = 1, .corrupt_permille = 1, .seed = 1}
+
+static const Scenario scenarios[] = {
+    {"clean_plain", false, CLEAN},
+    {"clean_lz", true, CLEAN},
+    {"lossy_plain", false, LOSSY},
+    {"lossy_lz", true, LOSSY},
+};
+
+static double elapsed_ms(clockid_t clock, const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static void write_source(void) {
+    uint32_t seed = 7;
+    FILE* out = fopen(source, "wb");
+    CHECK(out != NULL);
+    for(long length = 0; length < FILE_SIZE;) {
+        length += fprintf(
+            out,
+            "2026-10-16 12:00:%02u [INFO] sensor %u reading=%u\n",
+            test_random(&seed) % 60,
+            test_random(&seed) % 17,
+            test_random(&seed) % 5000);
+    }
+    fclose(out);
+}
+
+static void run(const Scenario* scenario) {
+    FuriString* path = furi_string_alloc();
+    fbs_link_open(&scenario->config);
+    CHECK(sender_fbs_init());
+    CHECK(receiver_fbs_init());
+    fbs_link_connect();
+
+    struct timespec wall;
+    struct timespec cpu;
+    clock_gettime(CLOCK_MONOTONIC, &wall);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+    fbs_link_receive_start(received_folder, path);
+    uint32_t attempts = fbs_link_send_until_received(source, scenario->compress, 100);
+    bool ok = fbs_link_receive_stop();
+    double wall_ms = elapsed_ms(CLOCK_MONOTONIC, &wall);
+    double cpu_ms = elapsed_ms(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+
+    FbsLinkStats sent = fbs_link_stats(FbsLinkSender);
+    uint32_t retries = sender_fbs_get_retries();
+    fbs_link_close();
+    sender_fbs_deinit();
+    receiver_fbs_deinit();
+    CHECK(ok);
+
+    struct stat info;
+    CHECK(stat(furi_string_get_cstr(path), &info) == 0);
+    printf(
+        "scenario=%s file_bytes=%lld air_bytes=%lu frames=%lu attempts=%lu dropped=%lu "
+        "corrupted=%lu retries=%lu wall_ms=%.1f cpu_ms=%.1f throughput_Bps=%.0f\n",
+        scenario->name,
+        (long long)info.st_size,
+        (unsigned long)sent.bytes,
+        (unsigned long)sent.frames,
+        (unsigned long)attempts,
+        (unsigned long)sent.dropped,
+        (unsigned long)sent.corrupted,
+        (unsigned long)retries,
+        wall_ms,
+        cpu_ms,
+        info.st_size * 1000.0 / wall_ms);
+    remove(furi_string_get_cstr(path));
+    furi_string_free(path);
+}
+
+int main(void) {
+    CHECK(mkdtemp(folder) != NULL);
+    snprintf(source, sizeof(source), "%s/source.txt", folder);
+    snprintf(received_folder, sizeof(received_folder), "%s/received", folder);
+    write_source();
+
+    for(size_t i = 0; i < COUNT_OF(scenarios); i++) {
+        run(&scenarios[i]);
+    }
+
+    rmdir(received_folder);
+    remove(source);
+    rmdir(folder);
+    return 0;
+}
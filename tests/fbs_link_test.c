@@ -0,0 +1,283 @@
+// File transfers between two builds of fbs.c over a simulated link: plain and compressed,
+// with frames lost and corrupted on the way, and a compressed stream that lies about its size
+
+#include "test.h"
+#include "fbs_link.h"
+#include "ble/lz_stream.h"
+#include <unistd.h>
+
+#define FILE_SIZE    (48 * 1024)
+#define MAX_ATTEMPTS 40
+// Data frames an eager sender gets in behind its start frame while the receiver is held
+#define EAGER_FRAMES 4
+
+static char folder[] = "/tmp/fbs_link_XXXXXX";
+static char source[64];
+static char received_folder[64];
+static uint8_t file[FILE_SIZE];
+static uint8_t copy[FILE_SIZE * 2];
+
+typedef struct {
+    bool ok;
+    uint32_t attempts;
+    uint32_t frames; // What the sender reported last
+    uint32_t retries;
+    FbsLinkStats sent;
+} Transfer;
+
+static void write_source(void) {
+    uint32_t seed = 7;
+    size_t length = 0;
+    while(length + 100 < FILE_SIZE) {
+        length += sprintf(
+            (char*)file + length,
+            "line %zu: value=%u flags=%s\n",
+            length,
+            test_random(&seed) % 100000,
+            test_random(&seed) % 3 ? "none" : "retry");
+    }
+    while(length < FILE_SIZE) {
+        file[length++] = '\n';
+    }
+
+    FILE* out = fopen(source, "wb");
+    CHECK(out != NULL);
+    CHECK_EQ(fwrite(file, 1, FILE_SIZE, out), FILE_SIZE);
+    fclose(out);
+}
+
+static size_t read_copy(const char* path) {
+    FILE* in = fopen(path, "rb");
+    if(!in) return 0;
+    size_t size = fread(copy, 1, sizeof(copy), in);
+    fclose(in);
+    return size;
+}
+
+static void link_up(const FbsLinkConfig* config) {
+    fbs_link_open(config);
+    CHECK(sender_fbs_init());
+    CHECK(receiver_fbs_init());
+    fbs_link_connect();
+}
+
+static void link_down(void) {
+    fbs_link_close();
+    sender_fbs_deinit();
+    receiver_fbs_deinit();
+}
+
+static void check_copy(const FuriString* path) {
+    CHECK(strstr(furi_string_get_cstr(path), "source.txt") != NULL);
+    CHECK_EQ(read_copy(furi_string_get_cstr(path)), FILE_SIZE);
+    CHECK(memcmp(copy, file, FILE_SIZE) == 0);
+}
+
+static Transfer transfer(const FbsLinkConfig* config, bool compress) {
+    Transfer result;
+    FuriString* path = furi_string_alloc();
+
+    link_up(config);
+    fbs_link_receive_start(received_folder, path);
+    result.attempts = fbs_link_send_until_received(source, compress, MAX_ATTEMPTS);
+    result.frames = sender_fbs_get_frames();
+    result.retries = sender_fbs_get_retries();
+    result.ok = fbs_link_receive_stop();
+    result.sent = fbs_link_stats(FbsLinkSender);
+    link_down();
+
+    if(result.ok) check_copy(path);
+    furi_string_free(path);
+    return result;
+}
+
+static void send_frame(uint8_t* frame, size_t size) {
+    BleProfileSerial* profile = fbs_link_profile(FbsLinkSender);
+    while(!sender_ble_profile_serial_tx(profile, frame, (uint16_t)size)) {
+        furi_delay_ms(1);
+    }
+}
+
+// A sender that never waits for the resume reply: each pass streams on straight after its
+// start frame, from where the receiver had got to. The receiver is held while the start
+// and the first data frames arrive, so they queue up behind the file the last pass broke.
+static Transfer send_eager(const FbsLinkConfig* config) {
+    Transfer result = {0};
+    uint8_t frame[FBS_FRAME_SIZE];
+    FuriString* path = furi_string_alloc();
+    bool finished = false;
+
+    link_up(config);
+    fbs_link_receive_start(received_folder, path);
+    while(!finished && result.attempts < MAX_ATTEMPTS && fbs_link_receive_hold(true)) {
+        result.attempts++;
+        // What the receiver's reply to this start frame will say
+        FileFrameHeader resume = {.seq = receiver_fbs_get_frames()};
+        resume.offset = resume.seq * FBS_FRAME_PAYLOAD;
+        FileProtocolSender sender;
+        file_protocol_sender_reset(&sender);
+        file_protocol_sender_resume(&sender, &resume);
+
+        send_frame(
+            frame, file_protocol_build_start(frame, sizeof(frame), "source.txt", FILE_SIZE, 0));
+        uint32_t held = 0;
+        for(size_t offset = 0; offset < FILE_SIZE;) {
+            size_t frame_size;
+            offset += file_protocol_build_data(
+                &sender, frame, sizeof(frame), file + offset, FILE_SIZE - offset, &frame_size);
+            if(frame_size == 0) continue;
+            send_frame(frame, frame_size);
+            if(++held == EAGER_FRAMES) {
+                // Let the receiver go once they are all queued behind the start frame
+                FbsLinkStats stats = fbs_link_stats(FbsLinkSender);
+                while(stats.delivered < stats.frames) {
+                    furi_delay_ms(1);
+                    stats = fbs_link_stats(FbsLinkSender);
+                }
+                fbs_link_receive_hold(false);
+            }
+        }
+        fbs_link_receive_hold(false);
+        send_frame(frame, file_protocol_build_end(&sender, frame, sizeof(frame)));
+        finished = fbs_link_receive_wait(200 + 4 * config->latency_ms);
+    }
+    result.ok = fbs_link_receive_stop();
+    result.sent = fbs_link_stats(FbsLinkSender);
+    link_down();
+
+    if(result.ok) check_copy(path);
+    furi_string_free(path);
+    return result;
+}
+
+// Send 'size' bytes of 'a' as one compressed stream while announcing 'announced' bytes
+static bool send_crafted(uint32_t size, uint32_t announced) {
+    static uint8_t input[FILE_SIZE];
+    static uint8_t packed[FILE_SIZE];
+    uint8_t frame[FBS_FRAME_SIZE];
+    FbsLinkConfig config = {.latency_ms = 1};
+    FuriString* path = furi_string_alloc();
+
+    memset(input, 'a', size);
+    LzEncoder* encoder = lz_encoder_alloc();
+    size_t taken = 0;
+    size_t packed_size = 0;
+    while(!lz_encoder_is_done(encoder)) {
+        taken += lz_encoder_sink(encoder, input + taken, size - taken);
+        if(taken == size) lz_encoder_finish(encoder);
+        packed_size +=
+            lz_encoder_poll(encoder, packed + packed_size, sizeof(packed) - packed_size);
+    }
+    lz_encoder_free(encoder);
+
+    link_up(&config);
+    fbs_link_receive_start(received_folder, path);
+    send_frame(
+        frame,
+        file_protocol_build_start(frame, sizeof(frame), "crafted.txt", announced, FILE_FLAG_LZ));
+    // Like fbs.c, wait for the receiver to answer with its resume point
+    while(fbs_link_stats(FbsLinkReceiver).frames == 0) {
+        furi_delay_ms(1);
+    }
+
+    FileProtocolSender sender;
+    file_protocol_sender_reset(&sender);
+    for(size_t offset = 0; offset < packed_size;) {
+        size_t frame_size;
+        offset += file_protocol_build_data(
+            &sender, frame, sizeof(frame), packed + offset, packed_size - offset, &frame_size);
+        send_frame(frame, frame_size);
+    }
+    send_frame(frame, file_protocol_build_end(&sender, frame, sizeof(frame)));
+
+    fbs_link_receive_wait(2000);
+    bool ok = fbs_link_receive_stop();
+    link_down();
+    // Nothing past the announced size reaches the card
+    if(!ok) CHECK(read_copy(furi_string_get_cstr(path)) <= announced);
+    furi_string_free(path);
+    return ok;
+}
+
+int main(void) {
+    CHECK(mkdtemp(folder) != NULL);
+    snprintf(source, sizeof(source), "%s/source.txt", folder);
+    snprintf(received_folder, sizeof(received_folder), "%s/received", folder);
+    write_source();
+
+    // A clean link delivers the file in one pass, one frame per payload plus start and end
+    FbsLinkConfig clean = {.latency_ms = 1};
+    Transfer plain = transfer(&clean, false);
+    CHECK(plain.ok);
+    CHECK_EQ(plain.attempts, 1);
+    CHECK_EQ(plain.sent.frames, (FILE_SIZE + FBS_FRAME_PAYLOAD - 1) / FBS_FRAME_PAYLOAD + 2);
+    CHECK_EQ(plain.frames, plain.sent.frames - 2);
+    CHECK_EQ(plain.retries, 0);
+
+    Transfer packed = transfer(&clean, true);
+    CHECK(packed.ok);
+    CHECK_EQ(packed.attempts, 1);
+    CHECK(packed.sent.bytes < plain.sent.bytes / 2);
+
+    // A busy stack refuses a frame now and then; it goes out again after a backoff, without
+    // breaking the transfer
+    FbsLinkConfig busy = {.latency_ms = 1, .refuse_permille = 50, .seed = 3};
+    Transfer retried = transfer(&busy, false);
+    CHECK(retried.ok);
+    CHECK_EQ(retried.attempts, 1);
+    CHECK(retried.retries > 0);
+    CHECK_EQ(retried.retries, retried.sent.refused);
+
+    // Lost and corrupted frames break the transfer; every new pass resumes after the last
+    // good byte, so the passes together send less than that many whole files
+    FbsLinkConfig lossy = {
+        .latency_ms = 1,
+        .drop_permille = 15,
+        .corrupt_permille = 15,
+        .seed = 5,
+    };
+    Transfer resumed = transfer(&lossy, false);
+    CHECK(resumed.ok);
+    CHECK(resumed.sent.dropped + resumed.sent.corrupted > 0);
+    CHECK(resumed.attempts > 1);
+    CHECK(resumed.sent.bytes < resumed.attempts * plain.sent.bytes);
+
+    // Compressed streams start over after a break, so they need the whole stream to get
+    // through in one pass; a lighter loss keeps the passes few
+    lossy.drop_permille = 5;
+    lossy.corrupt_permille = 5;
+    lossy.seed = 9;
+    Transfer restarted = transfer(&lossy, true);
+    CHECK(restarted.ok);
+    CHECK(restarted.sent.dropped + restarted.sent.corrupted > 0);
+
+    // Data right behind a start frame goes to the file that start frame opens, not to the
+    // one a broken pass left open
+    lossy.seed = 5;
+    lossy.drop_permille = 15;
+    lossy.corrupt_permille = 15;
+    Transfer eager = send_eager(&lossy);
+    CHECK(eager.ok);
+    CHECK(eager.attempts > 1);
+    CHECK(eager.sent.dropped + eager.sent.corrupted > 0);
+
+    // A stream that decodes to more than its start frame announced is refused
+    CHECK(send_crafted(5000, 5000));
+    CHECK(!send_crafted(5000, 1000));
+
+    char path[96];
+    snprintf(path, sizeof(path), "%s/source.txt", received_folder);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/crafted.txt", received_folder);
+    remove(path);
+    rmdir(received_folder);
+    remove(source);
+    rmdir(folder);
+
+    printf(
+        "fbs_link: ok (lossy: %lu passes, %lu dropped, %lu corrupted)\n",
+        (unsigned long)resumed.attempts,
+        (unsigned long)resumed.sent.dropped,
+        (unsigned long)resumed.sent.corrupted);
+    return 0;
+}
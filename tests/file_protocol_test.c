@@ -0,0 +1,331 @@
+// Frame building and parsing, CRC chaining, resume and the end-of-file checks of
+// file_protocol.c, driven through a reference receiver that stores into memory
+
+#include "test.h"
+#include "ble/file_protocol.h"
+
+#define FILE_SIZE  20000
+#define FRAME_SIZE 244
+
+typedef struct {
+    FileProtocolReceiver protocol;
+    uint8_t data[FILE_SIZE];
+    uint8_t reply[FILE_FRAME_HEADER_SIZE];
+    size_t reply_size;
+    bool complete;
+} ReferenceReceiver;
+
+static uint8_t file[FILE_SIZE];
+
+// What a receiver on the other end of the link does with one frame
+static FileReceiveEvent
+    reference_receive(ReferenceReceiver* receiver, uint8_t* frame, size_t size) {
+    const uint8_t* payload;
+    size_t length;
+    FileReceiveEvent event =
+        file_protocol_receive(&receiver->protocol, frame, size, &payload, &length);
+
+    switch(event) {
+    case FileReceiveEventStart:
+    case FileReceiveEventError:
+        receiver->reply_size = file_protocol_build_resume(
+            &receiver->protocol, receiver->reply, sizeof(receiver->reply));
+        break;
+    case FileReceiveEventData:
+        CHECK(receiver->protocol.offset <= FILE_SIZE);
+        memcpy(receiver->data + receiver->protocol.offset - length, payload, length);
+        break;
+    case FileReceiveEventEnd:
+        receiver->complete = true;
+        break;
+    default:
+        break;
+    }
+    return event;
+}
+
+// Send the start frame and adopt the receiver's answer
+static void send_start(FileProtocolSender* sender, ReferenceReceiver* receiver, uint8_t flags) {
+    uint8_t frame[FRAME_SIZE];
+    file_protocol_sender_reset(sender);
+    size_t size = file_protocol_build_start(frame, sizeof(frame), "log.txt", FILE_SIZE, flags);
+    CHECK_EQ(reference_receive(receiver, frame, size), FileReceiveEventStart);
+
+    FileFrameHeader resume;
+    const uint8_t* payload;
+    CHECK(file_protocol_parse(receiver->reply, receiver->reply_size, &resume, &payload));
+    CHECK_EQ(resume.type, FileFrameTypeResume);
+    file_protocol_sender_resume(sender, &resume);
+}
+
+// Send the file from the sender's position; 'corrupt' flips a bit in that data frame.
+// Returns the event of the first frame the receiver refused, or of the end frame.
+static FileReceiveEvent
+    send_file(FileProtocolSender* sender, ReferenceReceiver* receiver, uint32_t corrupt) {
+    uint8_t frame[FRAME_SIZE];
+    uint32_t frames = 0;
+
+    for(size_t offset = 0; offset < FILE_SIZE;) {
+        size_t size;
+        offset += file_protocol_build_data(
+            sender, frame, sizeof(frame), file + offset, FILE_SIZE - offset, &size);
+        if(size == 0) continue;
+        if(frames++ == corrupt) frame[FILE_FRAME_HEADER_SIZE + 3] ^= 0x10;
+        FileReceiveEvent event = reference_receive(receiver, frame, size);
+        if(event == FileReceiveEventError) return event;
+        CHECK_EQ(event, FileReceiveEventData);
+    }
+
+    size_t size = file_protocol_build_end(sender, frame, sizeof(frame));
+    return reference_receive(receiver, frame, size);
+}
+
+static void test_crc32(void) {
+    // The standard check value of CRC-32/ISO-HDLC, as computed by zlib's crc32()
+    CHECK_EQ(file_protocol_crc32(0, (const uint8_t*)"123456789", 9), 0xCBF43926);
+    CHECK_EQ(file_protocol_crc32(0, file, 0), 0);
+
+    // Chaining over any split gives the CRC of the whole
+    uint32_t whole = file_protocol_crc32(0, file, FILE_SIZE);
+    uint32_t seed = 7;
+    for(int round = 0; round < 100; round++) {
+        size_t split = test_random(&seed) % FILE_SIZE;
+        uint32_t crc = file_protocol_crc32(0, file, split);
+        CHECK_EQ(file_protocol_crc32(crc, file + split, FILE_SIZE - split), whole);
+    }
+}
+
+static void test_start_frame(void) {
+    uint8_t frame[FRAME_SIZE];
+    FileFrameHeader header;
+    const uint8_t* payload;
+    FileStartInfo info;
+
+    size_t size = file_protocol_build_start(frame, sizeof(frame), "notes.txt", 1234, FILE_FLAG_LZ);
+    CHECK_EQ(size, FILE_FRAME_HEADER_SIZE + sizeof(FileStartInfo) + 9);
+    CHECK(file_protocol_parse(frame, size, &header, &payload));
+    CHECK_EQ(header.type, FileFrameTypeStart);
+    CHECK_EQ(header.flags, FILE_FLAG_LZ);
+    memcpy(&info, payload, sizeof(info));
+    CHECK_EQ(info.version, FILE_PROTOCOL_VERSION);
+    CHECK_EQ(info.file_size, 1234);
+    CHECK(memcmp(payload + sizeof(info), "notes.txt", 9) == 0);
+
+    // Names are cut to FILE_FRAME_NAME_MAX, then to the room the frame has
+    char name[FILE_FRAME_NAME_MAX * 2 + 1];
+    memset(name, 'n', sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    size = file_protocol_build_start(frame, sizeof(frame), name, 1, 0);
+    CHECK_EQ(size, FILE_FRAME_HEADER_SIZE + sizeof(FileStartInfo) + FILE_FRAME_NAME_MAX);
+    size_t small = FILE_FRAME_HEADER_SIZE + sizeof(FileStartInfo) + 5;
+    CHECK_EQ(file_protocol_build_start(frame, small, name, 1, 0), small);
+    CHECK_EQ(file_protocol_build_start(frame, small - 6, name, 1, 0), 0);
+}
+
+static void test_parse_rejects(void) {
+    uint8_t frame[FRAME_SIZE];
+    FileFrameHeader header;
+    const uint8_t* payload;
+    FileProtocolSender sender;
+    file_protocol_sender_reset(&sender);
+
+    size_t size;
+    CHECK_EQ(file_protocol_build_data(&sender, frame, sizeof(frame), file, 100, &size), 100);
+    CHECK(file_protocol_parse(frame, size, &header, &payload));
+    CHECK(payload == frame + FILE_FRAME_HEADER_SIZE);
+    CHECK(!file_protocol_parse(frame, FILE_FRAME_HEADER_SIZE - 1, &header, &payload));
+    CHECK(!file_protocol_parse(frame, size - 1, &header, &payload));
+    CHECK(!file_protocol_parse(frame, size + 1, &header, &payload));
+    frame[size - 1] ^= 1;
+    CHECK(!file_protocol_parse(frame, size, &header, &payload));
+}
+
+static void test_data_frames(void) {
+    uint8_t frame[FRAME_SIZE];
+    FileFrameHeader header;
+    const uint8_t* payload;
+    FileProtocolSender sender;
+    file_protocol_sender_reset(&sender);
+    size_t room = FRAME_SIZE - FILE_FRAME_HEADER_SIZE;
+
+    // Copied from elsewhere, and framed in place from the body
+    size_t size;
+    CHECK_EQ(file_protocol_build_data(&sender, frame, sizeof(frame), file, 1000, &size), room);
+    CHECK_EQ(size, FRAME_SIZE);
+    memcpy(frame + FILE_FRAME_HEADER_SIZE, file + room, 10);
+    CHECK_EQ(
+        file_protocol_build_data(
+            &sender, frame, sizeof(frame), frame + FILE_FRAME_HEADER_SIZE, 10, &size),
+        10);
+    CHECK(file_protocol_parse(frame, size, &header, &payload));
+    CHECK_EQ(header.type, FileFrameTypeData);
+    CHECK_EQ(header.seq, 1);
+    CHECK_EQ(header.offset, room);
+    CHECK(memcmp(payload, file + room, 10) == 0);
+    CHECK_EQ(sender.file_crc, file_protocol_crc32(0, file, room + 10));
+
+    CHECK_EQ(
+        file_protocol_build_data(&sender, frame, FILE_FRAME_HEADER_SIZE, file, 10, &size), 0);
+}
+
+static void test_transfer(void) {
+    ReferenceReceiver receiver = {0};
+    FileProtocolSender sender;
+
+    send_start(&sender, &receiver, 0);
+    CHECK_EQ(send_file(&sender, &receiver, UINT32_MAX), FileReceiveEventEnd);
+    CHECK(receiver.complete);
+    CHECK(memcmp(receiver.data, file, FILE_SIZE) == 0);
+}
+
+// A corrupted frame breaks the transfer; the next start resumes from the last good byte
+static void test_resume(void) {
+    ReferenceReceiver receiver = {0};
+    FileProtocolSender sender;
+    uint32_t corrupt = 30;
+
+    send_start(&sender, &receiver, 0);
+    CHECK_EQ(send_file(&sender, &receiver, corrupt), FileReceiveEventError);
+    uint32_t good = receiver.protocol.offset;
+    CHECK_EQ(good, corrupt * (FRAME_SIZE - FILE_FRAME_HEADER_SIZE));
+    CHECK_EQ(receiver.protocol.next_seq, corrupt);
+
+    // Frames after the break are refused until a new start
+    uint8_t frame[FRAME_SIZE];
+    size_t size;
+    file_protocol_build_data(&sender, frame, sizeof(frame), file, 10, &size);
+    CHECK_EQ(reference_receive(&receiver, frame, size), FileReceiveEventError);
+
+    send_start(&sender, &receiver, 0);
+    CHECK_EQ(sender.resume_offset, good);
+    CHECK_EQ(sender.seq, corrupt);
+    CHECK_EQ(send_file(&sender, &receiver, UINT32_MAX), FileReceiveEventEnd);
+    CHECK(memcmp(receiver.data, file, FILE_SIZE) == 0);
+
+    // fbs resets the receiver after a finished file, so sending it again starts over
+    file_protocol_receiver_reset(&receiver.protocol);
+    send_start(&sender, &receiver, 0);
+    CHECK_EQ(sender.resume_offset, 0);
+}
+
+// Compressed streams cannot be joined midway, so they always start over
+static void test_resume_compressed(void) {
+    ReferenceReceiver receiver = {0};
+    FileProtocolSender sender;
+
+    send_start(&sender, &receiver, 0);
+    CHECK_EQ(send_file(&sender, &receiver, 10), FileReceiveEventError);
+    CHECK(receiver.protocol.offset > 0);
+
+    send_start(&sender, &receiver, FILE_FLAG_LZ);
+    CHECK_EQ(sender.flags, FILE_FLAG_LZ);
+    CHECK_EQ(sender.resume_offset, 0);
+    CHECK_EQ(receiver.protocol.offset, 0);
+}
+
+// Repeats of frames already received are dropped; gaps break the transfer
+static void test_sequence(void) {
+    ReferenceReceiver receiver = {0};
+    FileProtocolSender sender;
+    uint8_t first[FRAME_SIZE];
+    uint8_t frame[FRAME_SIZE];
+    size_t first_size;
+    size_t size;
+
+    send_start(&sender, &receiver, 0);
+    file_protocol_build_data(&sender, first, sizeof(first), file, 100, &first_size);
+    CHECK_EQ(reference_receive(&receiver, first, first_size), FileReceiveEventData);
+    CHECK_EQ(reference_receive(&receiver, first, first_size), FileReceiveEventNone);
+
+    file_protocol_build_data(&sender, frame, sizeof(frame), file + 100, 100, &size);
+    file_protocol_build_data(&sender, frame, sizeof(frame), file + 200, 100, &size);
+    CHECK_EQ(reference_receive(&receiver, frame, size), FileReceiveEventError);
+    CHECK_EQ(receiver.protocol.offset, 100);
+}
+
+static void test_end_checks(void) {
+    ReferenceReceiver receiver = {0};
+    FileProtocolSender sender;
+    uint8_t frame[FRAME_SIZE];
+    size_t size;
+
+    // Short of the announced size
+    send_start(&sender, &receiver, 0);
+    file_protocol_build_data(&sender, frame, sizeof(frame), file, 100, &size);
+    reference_receive(&receiver, frame, size);
+    size = file_protocol_build_end(&sender, frame, sizeof(frame));
+    CHECK_EQ(reference_receive(&receiver, frame, size), FileReceiveEventError);
+
+    // Whole-file CRC or chunk count that disagree with what arrived
+    for(int field = 0; field < 2; field++) {
+        file_protocol_receiver_reset(&receiver.protocol);
+        send_start(&sender, &receiver, 0);
+        for(size_t offset = 0; offset < FILE_SIZE;) {
+            offset += file_protocol_build_data(
+                &sender, frame, sizeof(frame), file + offset, FILE_SIZE - offset, &size);
+            CHECK_EQ(reference_receive(&receiver, frame, size), FileReceiveEventData);
+        }
+        if(field == 0) sender.file_crc ^= 1;
+        if(field == 1) sender.seq++;
+        size = file_protocol_build_end(&sender, frame, sizeof(frame));
+        CHECK_EQ(reference_receive(&receiver, frame, size), FileReceiveEventError);
+        CHECK(!receiver.protocol.active);
+    }
+
+    // Data past the announced size
+    file_protocol_receiver_reset(&receiver.protocol);
+    file_protocol_sender_reset(&sender);
+    size = file_protocol_build_start(frame, sizeof(frame), "log.txt", 10, 0);
+    CHECK_EQ(reference_receive(&receiver, frame, size), FileReceiveEventStart);
+    file_protocol_build_data(&sender, frame, sizeof(frame), file, 11, &size);
+    CHECK_EQ(reference_receive(&receiver, frame, size), FileReceiveEventError);
+
+    // An error frame from the sender
+    size = file_protocol_build_error(frame, sizeof(frame));
+    receiver.protocol.active = true;
+    CHECK_EQ(reference_receive(&receiver, frame, size), FileReceiveEventError);
+    CHECK(!receiver.protocol.active);
+}
+
+// A copy that fails the end check is not resumed; the file is sent again from the start
+static void test_end_check_restart(void) {
+    ReferenceReceiver receiver = {0};
+    FileProtocolSender sender;
+
+    send_start(&sender, &receiver, 0);
+    CHECK_EQ(send_file(&sender, &receiver, 30), FileReceiveEventError);
+    CHECK(receiver.protocol.offset > 0);
+
+    // Rewritten in place at the same size, below the resume point
+    file[0] ^= 0xFF;
+    send_start(&sender, &receiver, 0);
+    CHECK(sender.resume_offset > 0);
+    CHECK_EQ(send_file(&sender, &receiver, UINT32_MAX), FileReceiveEventError);
+    CHECK(!receiver.complete);
+
+    send_start(&sender, &receiver, 0);
+    CHECK_EQ(sender.resume_offset, 0);
+    CHECK_EQ(send_file(&sender, &receiver, UINT32_MAX), FileReceiveEventEnd);
+    CHECK(memcmp(receiver.data, file, FILE_SIZE) == 0);
+    file[0] ^= 0xFF;
+}
+
+int main(void) {
+    uint32_t seed = 1;
+    for(size_t i = 0; i < FILE_SIZE; i++) {
+        file[i] = (uint8_t)test_random(&seed);
+    }
+
+    test_crc32();
+    test_start_frame();
+    test_parse_rejects();
+    test_data_frames();
+    test_transfer();
+    test_resume();
+    test_resume_compressed();
+    test_sequence();
+    test_end_checks();
+    test_end_check_restart();
+    printf("file_protocol: ok\n");
+    return 0;
+}
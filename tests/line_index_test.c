@@ -0,0 +1,199 @@
+// line_index.c against line starts split directly with doc_stream_next_line(): indexing from
+// the top, from partway down with lines put in front of it, and saved tables read back
+
+#include "test.h"
+#include "reader/line_index.h"
+#include <string.h>
+#include <unistd.h>
+
+#define DOC_SIZE  (128 * 1024)
+#define MAX_LINES DOC_SIZE
+
+static char folder[] = "/tmp/line_index_test_XXXXXX";
+static char doc_path[96];
+static uint32_t starts[MAX_LINES + 1];
+static uint32_t lines;
+
+// Mostly short lines, some empty ones and a few longer than DOC_STREAM_LINE_MAX
+static void doc_write(void) {
+    FILE* out = fopen(doc_path, "wb");
+    CHECK(out != NULL);
+    uint32_t seed = 7;
+    uint32_t written = 0;
+    while(written < DOC_SIZE) {
+        uint32_t kind = test_random(&seed) % 100;
+        uint32_t length = kind == 0 ? 1500 + test_random(&seed) % 3000 :
+                          kind < 8  ? 0 :
+                                      test_random(&seed) % 120;
+        for(uint32_t i = 0; i < length && written < DOC_SIZE - 1; i++, written++) {
+            fputc('a' + test_random(&seed) % 26, out);
+        }
+        fputc('\n', out);
+        written++;
+    }
+    fclose(out);
+}
+
+static void doc_split(DocStream* stream) {
+    uint32_t size = doc_stream_size(stream);
+    lines = 0;
+    starts[0] = 0;
+    while(starts[lines] < size) {
+        starts[lines + 1] = doc_stream_next_line(stream, starts[lines]);
+        lines++;
+    }
+}
+
+// 'index' holds lines first..first + count - 1 of the document
+static void check_index(LineIndex* index, DocStream* stream, uint32_t first, uint32_t count) {
+    CHECK_EQ(line_index_count(index), count);
+    CHECK_EQ(line_index_origin(index), starts[first]);
+    CHECK_EQ(line_index_end(index), starts[first + count]);
+
+    for(uint32_t line = 0; line < count; line++) {
+        CHECK_EQ(line_index_line_start(index, stream, line), starts[first + line]);
+        CHECK_EQ(line_index_line_end(index, stream, line), starts[first + line + 1]);
+    }
+    uint32_t seed = first + count + 1;
+    for(int i = 0; i < 500 && count > 0; i++) {
+        uint32_t line = test_random(&seed) % count;
+        uint32_t span = starts[first + line + 1] - starts[first + line];
+        uint32_t offset = starts[first + line] + test_random(&seed) % span;
+        CHECK_EQ(line_index_find(index, stream, offset), line);
+    }
+}
+
+static void test_from_top(LineIndex* index, DocStream* stream) {
+    line_index_reset(index);
+    for(uint32_t line = 0; line < lines; line++) {
+        CHECK(line_index_push(index, starts[line + 1]));
+    }
+    check_index(index, stream, 0, lines);
+}
+
+// Start far down the document, then put randomly sized runs of lines in front until the top
+// is reached, looking lines up in between so decoded blocks have to move along
+static void test_prepend(LineIndex* index, DocStream* stream, uint32_t first, uint32_t below) {
+    uint32_t seed = first + below + 3;
+    line_index_reset_at(index, starts[first]);
+    for(uint32_t line = 0; line < below; line++) {
+        CHECK(line_index_push(index, starts[first + line + 1]));
+    }
+    uint32_t count = below;
+    check_index(index, stream, first, count);
+
+    while(first > 0) {
+        uint32_t run = test_random(&seed) % 150 + 1;
+        if(run > first) run = first;
+        if(count > 0) line_index_line_start(index, stream, test_random(&seed) % count);
+        first -= run;
+        CHECK(line_index_prepend(index, starts + first, run));
+        count += run;
+        check_index(index, stream, first, count);
+
+        // The tail keeps growing after lines were put in front
+        if(first + count < lines && test_random(&seed) % 2) {
+            CHECK(line_index_push(index, starts[first + count + 1]));
+            count++;
+        }
+    }
+    check_index(index, stream, 0, count);
+}
+
+static void test_pop(LineIndex* index, DocStream* stream) {
+    line_index_reset_at(index, starts[100]);
+    for(uint32_t line = 100; line < 130; line++) {
+        CHECK(line_index_push(index, starts[line + 1]));
+    }
+    CHECK(line_index_prepend(index, starts + 95, 5));
+    for(uint32_t count = 35; count > 0; count--) {
+        line_index_pop(index, stream);
+        check_index(index, stream, 95, count - 1);
+    }
+    // An emptied index fills its first block from the front again
+    for(uint32_t line = 95; line < 300; line++) {
+        CHECK(line_index_push(index, starts[line + 1]));
+    }
+    check_index(index, stream, 95, 205);
+
+    // Follow mode drops an unfinished last line from an index that only grew upwards, which
+    // leaves block 0 as the tail with free slots in front of it
+    line_index_reset_at(index, starts[500]);
+    CHECK(line_index_prepend(index, starts + 495, 5));
+    line_index_pop(index, stream);
+    check_index(index, stream, 495, 4);
+    CHECK(line_index_prepend(index, starts + 490, 5));
+    check_index(index, stream, 490, 9);
+    CHECK(line_index_prepend(index, starts + 400, 90));
+    check_index(index, stream, 400, 99);
+    CHECK(line_index_push(index, starts[500]));
+    check_index(index, stream, 400, 100);
+}
+
+static void test_write_read(LineIndex* index, DocStream* stream) {
+    char path[96];
+    snprintf(path, sizeof(path), "%s/index", folder);
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    LineIndex* loaded = line_index_alloc();
+
+    // Block 0 of an index that grew upwards to the top starts partway in
+    for(uint32_t count = 1; count < 200; count += 37) {
+        test_prepend(index, stream, lines / 2, count);
+        File* file = storage_file_alloc(storage);
+        CHECK(storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS));
+        CHECK(line_index_write(index, file));
+        storage_file_close(file);
+        CHECK(storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING));
+        CHECK(line_index_read(loaded, file));
+        storage_file_close(file);
+        storage_file_free(file);
+
+        uint32_t total = line_index_count(index);
+        check_index(loaded, stream, 0, total);
+        line_index_pop(loaded, stream);
+        CHECK(line_index_push(loaded, starts[total]));
+        CHECK(line_index_push(loaded, starts[total + 1]));
+        check_index(loaded, stream, 0, total + 1);
+    }
+
+    // Only an index from the top can be checked against the file later
+    line_index_reset_at(index, starts[10]);
+    File* file = storage_file_alloc(storage);
+    CHECK(storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS));
+    CHECK(!line_index_write(index, file));
+    storage_file_close(file);
+    storage_file_free(file);
+
+    line_index_free(loaded);
+    furi_record_close(RECORD_STORAGE);
+    remove(path);
+}
+
+int main(void) {
+    CHECK(mkdtemp(folder) != NULL);
+    snprintf(doc_path, sizeof(doc_path), "%s/doc.txt", folder);
+    block_cache_init();
+    doc_write();
+
+    DocStream* stream = doc_stream_alloc();
+    LineIndex* index = line_index_alloc();
+    CHECK(doc_stream_open(stream, doc_path));
+    doc_split(stream);
+    CHECK(lines > 1000);
+
+    test_from_top(index, stream);
+    test_prepend(index, stream, lines - 1, 1);
+    test_prepend(index, stream, lines / 3, 64);
+    test_prepend(index, stream, 700, 0);
+    test_prepend(index, stream, 64 * 5, 64 * 2 + 5);
+    test_pop(index, stream);
+    test_write_read(index, stream);
+
+    line_index_free(index);
+    doc_stream_free(stream);
+    block_cache_deinit();
+    remove(doc_path);
+    rmdir(folder);
+    printf("line_index: ok (%lu lines)\n", (unsigned long)lines);
+    return 0;
+}
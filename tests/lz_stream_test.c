@@ -0,0 +1,118 @@
+// Round trips through lz_stream.c with input and output handed over in random pieces, the
+// way fbs.c feeds it from storage reads and BLE frames
+
+#include "test.h"
+#include "ble/lz_stream.h"
+#include <string.h>
+
+#define MAX_INPUT (256 * 1024)
+
+static uint8_t input[MAX_INPUT];
+static uint8_t packed[MAX_INPUT * 2];
+static uint8_t output[MAX_INPUT];
+
+// Compress 'size' bytes of input and return the compressed size
+static size_t compress(size_t size, uint32_t* seed) {
+    LzEncoder* encoder = lz_encoder_alloc();
+    size_t taken = 0;
+    size_t packed_size = 0;
+
+    if(size == 0) lz_encoder_finish(encoder);
+    while(!lz_encoder_is_done(encoder)) {
+        if(taken < size) {
+            size_t piece = test_random(seed) % 700 + 1;
+            if(piece > size - taken) piece = size - taken;
+            taken += lz_encoder_sink(encoder, input + taken, piece);
+            if(taken == size) lz_encoder_finish(encoder);
+        }
+        size_t room = test_random(seed) % 470 + 1;
+        CHECK(packed_size + room <= sizeof(packed));
+        packed_size += lz_encoder_poll(encoder, packed + packed_size, room);
+    }
+
+    lz_encoder_free(encoder);
+    return packed_size;
+}
+
+static size_t decompress(size_t packed_size, uint32_t* seed) {
+    LzDecoder* decoder = lz_decoder_alloc();
+    size_t sunk = 0;
+    size_t size = 0;
+
+    for(;;) {
+        size_t piece = test_random(seed) % 100 + 1;
+        if(piece > packed_size - sunk) piece = packed_size - sunk;
+        sunk += lz_decoder_sink(decoder, packed + sunk, piece);
+
+        size_t room = test_random(seed) % 300 + 1;
+        if(room > sizeof(output) - size) room = sizeof(output) - size;
+        size_t produced = lz_decoder_poll(decoder, output + size, room);
+        size += produced;
+        if(sunk == packed_size && produced == 0) break;
+    }
+
+    lz_decoder_free(decoder);
+    return size;
+}
+
+static size_t round_trip(size_t size) {
+    uint32_t seed = (uint32_t)size * 2654435761u + 1;
+    size_t packed_size = compress(size, &seed);
+    CHECK_EQ(decompress(packed_size, &seed), size);
+    CHECK(memcmp(input, output, size) == 0);
+    return packed_size;
+}
+
+static size_t fill_log(size_t size) {
+    uint32_t seed = 3;
+    size_t length = 0;
+    for(int line = 0; length + 128 < size; line++) {
+        length += sprintf(
+            (char*)input + length,
+            "2026-10-16 12:%02d:%02d.%03d [INFO] sensor %d reading=%u status=%s\n",
+            line / 60 % 60,
+            line % 60,
+            line * 7 % 1000,
+            line % 17,
+            test_random(&seed) % 5000,
+            test_random(&seed) % 4 ? "OK" : "RETRY");
+    }
+    return length;
+}
+
+int main(void) {
+    // Text compresses, and every byte of it comes back
+    size_t size = fill_log(MAX_INPUT);
+    size_t packed_size = round_trip(size);
+    CHECK(packed_size < size / 2);
+
+    // Random bytes grow by no more than the flag bytes
+    uint32_t seed = 11;
+    for(size_t i = 0; i < 100000; i++) {
+        input[i] = (uint8_t)test_random(&seed);
+    }
+    CHECK(round_trip(100000) <= 100000 + 100000 / 8 + 1);
+
+    // Runs use overlapping matches up to the longest match length
+    memset(input, 'a', 5000);
+    CHECK(round_trip(5000) < 300);
+
+    // Lengths around the minimum match and the window size
+    for(size_t small = 0; small <= 8; small++) {
+        round_trip(small);
+    }
+    fill_log(MAX_INPUT);
+    round_trip(LZ_WINDOW - 1);
+    round_trip(LZ_WINDOW);
+    round_trip(LZ_WINDOW + 1);
+    round_trip(3 * LZ_WINDOW + LZ_MATCH_MAX);
+
+    // Garbage decodes to something without reading or writing out of bounds
+    for(size_t i = 0; i < 4096; i++) {
+        packed[i] = (uint8_t)test_random(&seed);
+    }
+    CHECK(decompress(4096, &seed) <= sizeof(output));
+
+    printf("lz_stream: ok (log %zu -> %zu bytes)\n", size, packed_size);
+    return 0;
+}
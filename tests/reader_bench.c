@@ -0,0 +1,354 @@
+// Indexing, line lookup and search over the corpus DOCVIEW_BENCH builds write on the device,
+// through the same doc_stream, block cache, line_index and doc_search code. One key=value
+// line per measurement, best of BENCH_ROUNDS, so runs can be diffed between builds.
+//
+// Open to first page and auto-scroll redraws go through docview_reader.c, the reader the
+// app draws with, on the counting canvas in stub/canvas_host.c. The indexer's batches run
+// inline between draws instead of on a thread, and nothing reaches a display, so these are
+// the reader's own CPU costs: storage latency and the 1 s auto-scroll timer are not in them.
+
+#include "test.h"
+#include "docview_reader.h"
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_ROUNDS  5
+#define BENCH_LOOKUPS 20000
+#define BENCH_BLOCK   512
+// Same as INDEXER_BATCH_LINES in docview.c
+#define BENCH_BATCH_LINES 64
+#define BENCH_TICKS       2000
+
+typedef enum {
+    CorpusText,
+    CorpusLongLines,
+    CorpusBinary,
+} CorpusKind;
+
+typedef struct {
+    const char* name;
+    uint32_t size;
+    CorpusKind kind;
+} Corpus;
+
+// Same names, sizes and contents as Docview_bench_corpus() in docview.c
+static const Corpus corpora[] = {
+    {"bench_text.txt", 256 * 1024, CorpusText},
+    {"bench_long.txt", 64 * 1024, CorpusLongLines},
+    {"bench_binary.bin", 64 * 1024, CorpusBinary},
+};
+
+static char folder[] = "/tmp/reader_bench_XXXXXX";
+
+static double bench_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void corpus_write(const Corpus* corpus, const char* path) {
+    FILE* out = fopen(path, "wb");
+    CHECK(out != NULL);
+    uint8_t block[BENCH_BLOCK];
+    uint32_t line_length = corpus->kind == CorpusText ? 72 : 4000;
+    uint32_t seed = 0x2545F491;
+    uint32_t column = 0;
+
+    for(uint32_t written = 0; written < corpus->size; written += sizeof(block)) {
+        for(size_t i = 0; i < sizeof(block); i++) {
+            seed = seed * 1664525 + 1013904223;
+            uint8_t byte = seed >> 24;
+            if(corpus->kind != CorpusBinary) {
+                byte = (byte % 6) ? 'a' + byte % 26 : ' ';
+                if(++column >= line_length) {
+                    byte = '\n';
+                    column = 0;
+                }
+            }
+            block[i] = byte;
+        }
+        CHECK_EQ(fwrite(block, 1, sizeof(block), out), sizeof(block));
+    }
+    fclose(out);
+}
+
+// The indexer thread's loop, without the view model around it
+static uint32_t bench_index(DocStream* stream, LineIndex* index) {
+    uint32_t size = doc_stream_size(stream);
+    line_index_reset(index);
+    for(uint32_t offset = 0; offset < size;) {
+        offset = doc_stream_next_line(stream, offset);
+        CHECK(line_index_push(index, offset));
+    }
+    return line_index_count(index);
+}
+
+static uint32_t bench_lookups(DocStream* stream, LineIndex* index) {
+    uint32_t lines = line_index_count(index);
+    uint32_t seed = 1;
+    uint32_t sum = 0;
+    for(uint32_t i = 0; i < BENCH_LOOKUPS; i++) {
+        sum += line_index_line_start(index, stream, test_random(&seed) % lines);
+    }
+    return sum;
+}
+
+// Enter the reader on 'path' and run the indexer's steps in the order its thread takes them,
+// drawing whenever the reader would, until the first page is up. Returns the draws it took.
+static uint32_t bench_first_page(DocviewReaderModel* model, Canvas* canvas, DocStream* stream) {
+    uint32_t start, end;
+    CHECK(Docview_load_document(model));
+    Docview_draw_reader(canvas, model, &start, &end);
+    uint32_t draws = 1;
+
+    CHECK(doc_stream_open(stream, model->document_path));
+    uint32_t size = doc_stream_size(stream);
+    if(model->index_above && !model->hex_view) {
+        uint32_t starts[ABOVE_STARTS_MAX];
+        uint32_t anchor = line_index_origin(model->index);
+        size_t count = Docview_scan_above(stream, anchor, starts);
+        CHECK(Docview_index_above_done(model, anchor, starts, count));
+        Docview_draw_reader(canvas, model, &start, &end);
+        draws++;
+    }
+
+    uint32_t offset = line_index_end(model->index);
+    uint32_t batch[BENCH_BATCH_LINES];
+    while(!Docview_first_page_ready(model)) {
+        uint32_t batch_start = offset;
+        size_t count = 0;
+        while(count < BENCH_BATCH_LINES && offset < size) {
+            offset = doc_stream_next_line(stream, offset);
+            batch[count++] = offset;
+        }
+        bool redraw = true;
+        Docview_index_batch(model, batch_start, batch, count, size, &redraw);
+        Docview_draw_reader(canvas, model, &start, &end);
+        draws++;
+    }
+    return draws;
+}
+
+// Index the rest of the document the way the indexer does after the first page
+static void bench_index_rest(DocviewReaderModel* model, DocStream* stream) {
+    uint32_t size = doc_stream_size(stream);
+    uint32_t offset = line_index_end(model->index);
+    uint32_t batch[BENCH_BATCH_LINES];
+    bool more = !Docview_indexing_done(model);
+    while(more) {
+        uint32_t batch_start = offset;
+        size_t count = 0;
+        while(count < BENCH_BATCH_LINES && offset < size) {
+            offset = doc_stream_next_line(stream, offset);
+            batch[count++] = offset;
+        }
+        bool redraw = false;
+        more = Docview_index_batch(model, batch_start, batch, count, size, &redraw);
+    }
+}
+
+static void bench_open(const char* name, const char* path, bool at_end) {
+    double best = 1e18;
+    uint32_t draws = 0;
+    for(int round = 0; round < BENCH_ROUNDS; round++) {
+        // Every round opens cold, as after starting the app
+        block_cache_deinit();
+        block_cache_init();
+        DocviewReaderModel model;
+        Docview_model_init(&model);
+        strlcpy(model.document_path, path, sizeof(model.document_path));
+        model.open_at_end = at_end;
+        Canvas* canvas = canvas_host_alloc();
+        DocStream* stream = doc_stream_alloc();
+        doc_stream_set_hint(stream, BlockCacheHintSequential);
+
+        double start = bench_now_us();
+        draws = bench_first_page(&model, canvas, stream);
+        double elapsed = bench_now_us() - start;
+        if(elapsed < best) best = elapsed;
+
+        doc_stream_free(stream);
+        canvas_host_free(canvas);
+        Docview_model_free(&model);
+    }
+    printf(
+        "bench metric=first_page file=%s at_end=%u draws=%lu us=%.0f\n",
+        name,
+        at_end,
+        (unsigned long)draws,
+        best);
+}
+
+// Auto-scroll timer ticks from the top of a fully indexed document, each followed by the
+// redraw the timer asks for when the view moved
+static void bench_redraw(const char* name, DocviewReaderModel* model, bool wrap, bool hex) {
+    double best = 1e18;
+    uint32_t draws = 0;
+    CanvasHostStats drawn = {0};
+    for(int round = 0; round < BENCH_ROUNDS; round++) {
+        Canvas* canvas = canvas_host_alloc();
+        model->word_wrap = wrap;
+        model->hex_view = hex;
+        model->auto_scroll = true;
+        model->scroll_position = 0;
+        model->wrap_row = 0;
+        model->h_scroll_offset = 0;
+        model->hex_row = 0;
+        uint32_t start, end;
+        Docview_draw_reader(canvas, model, &start, &end);
+
+        draws = 0;
+        double begin = bench_now_us();
+        for(uint32_t tick = 0; tick < BENCH_TICKS; tick++) {
+            DocviewViewState before = Docview_view_state(model);
+            Docview_auto_scroll_step(model);
+            if(!Docview_view_state_changed(&before, model)) continue;
+            Docview_draw_reader(canvas, model, &start, &end);
+            draws++;
+        }
+        double elapsed = bench_now_us() - begin;
+        if(elapsed < best) best = elapsed;
+        canvas_host_get_stats(canvas, &drawn);
+        canvas_host_free(canvas);
+    }
+    printf(
+        "bench metric=redraw file=%s wrap=%u hex=%u draws=%lu per_s=%.0f draw_us=%.2f "
+        "strings=%lu\n",
+        name,
+        wrap,
+        hex,
+        (unsigned long)draws,
+        draws * 1e6 / best,
+        draws ? best / draws : 0.0,
+        (unsigned long)drawn.strings);
+}
+
+static void bench_reader(const Corpus* corpus, const char* path) {
+    bench_open(corpus->name, path, false);
+    bench_open(corpus->name, path, true);
+
+    DocviewReaderModel model;
+    Docview_model_init(&model);
+    strlcpy(model.document_path, path, sizeof(model.document_path));
+    Canvas* canvas = canvas_host_alloc();
+    DocStream* stream = doc_stream_alloc();
+    bench_first_page(&model, canvas, stream);
+    bench_index_rest(&model, stream);
+    CHECK(model.is_fully_indexed);
+
+    bench_redraw(corpus->name, &model, false, false);
+    bench_redraw(corpus->name, &model, true, false);
+    bench_redraw(corpus->name, &model, false, true);
+
+    doc_stream_free(stream);
+    canvas_host_free(canvas);
+    Docview_model_free(&model);
+}
+
+static uint32_t bench_search(DocSearch* search, DocStream* stream, bool backward) {
+    uint32_t size = doc_stream_size(stream);
+    return backward ? doc_search_backward(search, stream, size, 0) :
+                      doc_search_forward(search, stream, 0, size);
+}
+
+static void bench_corpus(const Corpus* corpus) {
+    char path[96];
+    snprintf(path, sizeof(path), "%s/%s", folder, corpus->name);
+    corpus_write(corpus, path);
+
+    DocStream* stream = doc_stream_alloc();
+    LineIndex* index = line_index_alloc();
+    DocSearch* search = doc_search_alloc();
+    CHECK(doc_stream_open(stream, path));
+    uint32_t size = doc_stream_size(stream);
+
+    double best = 1e18;
+    uint32_t lines = 0;
+    for(int round = 0; round < BENCH_ROUNDS; round++) {
+        double start = bench_now_us();
+        lines = bench_index(stream, index);
+        double elapsed = bench_now_us() - start;
+        if(elapsed < best) best = elapsed;
+    }
+    printf(
+        "bench metric=index file=%s bytes=%lu lines=%lu us=%.0f mbps=%.1f\n",
+        corpus->name,
+        (unsigned long)size,
+        (unsigned long)lines,
+        best,
+        size / best);
+
+    best = 1e18;
+    uint32_t sum = 0;
+    for(int round = 0; round < BENCH_ROUNDS; round++) {
+        double start = bench_now_us();
+        sum += bench_lookups(stream, index);
+        double elapsed = bench_now_us() - start;
+        if(elapsed < best) best = elapsed;
+    }
+    printf(
+        "bench metric=line_start file=%s lookups=%u ns_per=%.0f checksum=%lu\n",
+        corpus->name,
+        BENCH_LOOKUPS,
+        best * 1000 / BENCH_LOOKUPS,
+        (unsigned long)sum);
+
+    // A needle that never matches scans the whole file, the slowest search there is
+    static const struct {
+        const char* label;
+        const char* needle;
+        bool ignore_case;
+        bool backward;
+    } searches[] = {
+        {"miss", "zqzqzqzq", false, false},
+        {"miss_nocase", "ZQZQZQZQ", true, false},
+        {"miss_backward", "zqzqzqzq", false, true},
+        {"short", "q", false, false},
+    };
+    for(size_t s = 0; s < COUNT_OF(searches); s++) {
+        CHECK(doc_search_set_needle(search, searches[s].needle, searches[s].ignore_case));
+        best = 1e18;
+        uint32_t match = DOC_SEARCH_NONE;
+        for(int round = 0; round < BENCH_ROUNDS; round++) {
+            double start = bench_now_us();
+            match = bench_search(search, stream, searches[s].backward);
+            double elapsed = bench_now_us() - start;
+            if(elapsed < best) best = elapsed;
+        }
+        printf(
+            "bench metric=search file=%s kind=%s found=%d us=%.0f mbps=%.1f\n",
+            corpus->name,
+            searches[s].label,
+            match != DOC_SEARCH_NONE,
+            best,
+            match == DOC_SEARCH_NONE ? size / best : 0.0);
+    }
+
+    doc_search_free(search);
+    line_index_free(index);
+    doc_stream_free(stream);
+
+    bench_reader(corpus, path);
+    remove(path);
+}
+
+int main(void) {
+    CHECK(mkdtemp(folder) != NULL);
+    block_cache_init();
+
+    for(size_t i = 0; i < COUNT_OF(corpora); i++) {
+        bench_corpus(&corpora[i]);
+    }
+
+    BlockCacheStats blocks;
+    block_cache_get_stats(&blocks);
+    printf(
+        "bench metric=block_cache hits=%lu misses=%lu prefetched=%lu\n",
+        (unsigned long)blocks.hits,
+        (unsigned long)blocks.misses,
+        (unsigned long)blocks.prefetched);
+
+    block_cache_deinit();
+    rmdir(folder);
+    return 0;
+}
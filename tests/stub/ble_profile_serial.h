@@ -0,0 +1,42 @@
+#pragma once
+
+// The serial profile's API; tests provide its implementation, usually a simulated link
+
+#include <furi.h>
+
+#define BLE_PROFILE_SERIAL_PACKET_SIZE_MAX 486
+
+typedef struct BleProfileSerial BleProfileSerial;
+
+typedef enum {
+    SerialServiceEventTypeDataReceived,
+    SerialServiceEventTypeDataSent,
+    SerialServiceEventTypesBleResetRequest,
+} SerialServiceEventType;
+
+typedef struct {
+    uint8_t* buffer;
+    uint16_t size;
+} SerialServiceData;
+
+typedef struct {
+    SerialServiceEventType event;
+    SerialServiceData data;
+} SerialServiceEvent;
+
+typedef uint16_t (*SerialServiceEventCallback)(SerialServiceEvent event, void* context);
+typedef void (*BleProfileSerialConnectionCallback)(void* context);
+
+BleProfileSerial* ble_profile_serial_init(void);
+void ble_profile_serial_deinit(BleProfileSerial* profile);
+bool ble_profile_serial_tx(BleProfileSerial* profile, uint8_t* data, uint16_t size);
+void ble_profile_serial_set_connection_callbacks(
+    BleProfileSerial* profile,
+    BleProfileSerialConnectionCallback on_connect,
+    BleProfileSerialConnectionCallback on_disconnect,
+    void* context);
+void ble_profile_serial_set_event_callback(
+    BleProfileSerial* profile,
+    uint16_t buffer_size,
+    SerialServiceEventCallback callback,
+    void* context);
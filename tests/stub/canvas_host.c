@@ -0,0 +1,76 @@
+#include <gui/canvas.h>
+#include <gui/elements.h>
+
+struct Canvas {
+    Font font;
+    CanvasHostStats stats;
+};
+
+Canvas* canvas_host_alloc(void) {
+    return calloc(1, sizeof(Canvas));
+}
+
+void canvas_host_free(Canvas* canvas) {
+    free(canvas);
+}
+
+void canvas_host_get_stats(const Canvas* canvas, CanvasHostStats* stats) {
+    *stats = canvas->stats;
+}
+
+void canvas_set_font(Canvas* canvas, Font font) {
+    canvas->font = font;
+}
+
+void canvas_set_color(Canvas* canvas, Color color) {
+    UNUSED(canvas);
+    UNUSED(color);
+}
+
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* str) {
+    UNUSED(x);
+    UNUSED(y);
+    canvas->stats.strings++;
+    canvas->stats.bytes += strlen(str);
+}
+
+void canvas_draw_str_aligned(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    Align horizontal,
+    Align vertical,
+    const char* str) {
+    UNUSED(horizontal);
+    UNUSED(vertical);
+    canvas_draw_str(canvas, x, y, str);
+}
+
+// Close to the firmware fonts: 5 px for the small one and 6 px for the large one
+size_t canvas_glyph_width(Canvas* canvas, uint16_t symbol) {
+    if(symbol < 32 || symbol > 126) return 0;
+    return canvas->font == FontPrimary ? 6 : 5;
+}
+
+void canvas_draw_line(Canvas* canvas, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    UNUSED(canvas);
+    UNUSED(x1);
+    UNUSED(y1);
+    UNUSED(x2);
+    UNUSED(y2);
+}
+
+void elements_scrollbar_pos(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    size_t height,
+    size_t pos,
+    size_t total) {
+    UNUSED(canvas);
+    UNUSED(x);
+    UNUSED(y);
+    UNUSED(height);
+    UNUSED(pos);
+    UNUSED(total);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+// Just enough of the firmware's furi.h for the modules that do not touch the hardware to
+// build and run on a host
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNUSED(x)      (void)(x)
+#define COUNT_OF(x)    (sizeof(x) / sizeof((x)[0]))
+#define FURI_PACKED    __attribute__((packed))
+#define furi_assert(x) furi_check(x)
+#define furi_check(x)                                                                    \
+    do {                                                                                 \
+        if(!(x)) {                                                                       \
+            fprintf(stderr, "%s:%d: furi_check failed: %s\n", __FILE__, __LINE__, #x); \
+            abort();                                                                     \
+        }                                                                                \
+    } while(0)
+
+#define FuriWaitForever 0xFFFFFFFFU
+
+typedef enum {
+    FuriStatusOk = 0,
+    FuriStatusError = -1,
+    FuriStatusErrorTimeout = -2,
+    FuriStatusErrorResource = -3,
+} FuriStatus;
+
+// The primitives below are implemented over pthreads in furi_host.c, with 1 ms ticks
+
+uint32_t furi_get_tick(void);
+uint32_t furi_ms_to_ticks(uint32_t ms);
+void furi_delay_ms(uint32_t ms);
+
+typedef enum {
+    FuriMutexTypeNormal,
+    FuriMutexTypeRecursive,
+} FuriMutexType;
+
+typedef struct FuriMutex FuriMutex;
+FuriMutex* furi_mutex_alloc(FuriMutexType type);
+void furi_mutex_free(FuriMutex* mutex);
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout);
+FuriStatus furi_mutex_release(FuriMutex* mutex);
+
+typedef struct FuriSemaphore FuriSemaphore;
+FuriSemaphore* furi_semaphore_alloc(uint32_t max_count, uint32_t initial_count);
+void furi_semaphore_free(FuriSemaphore* semaphore);
+FuriStatus furi_semaphore_acquire(FuriSemaphore* semaphore, uint32_t timeout);
+FuriStatus furi_semaphore_release(FuriSemaphore* semaphore);
+uint32_t furi_semaphore_get_count(FuriSemaphore* semaphore);
+
+typedef struct FuriMessageQueue FuriMessageQueue;
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size);
+void furi_message_queue_free(FuriMessageQueue* queue);
+FuriStatus furi_message_queue_put(FuriMessageQueue* queue, const void* msg, uint32_t timeout);
+FuriStatus furi_message_queue_get(FuriMessageQueue* queue, void* msg, uint32_t timeout);
+FuriStatus furi_message_queue_reset(FuriMessageQueue* queue);
+
+typedef struct FuriStreamBuffer FuriStreamBuffer;
+FuriStreamBuffer* furi_stream_buffer_alloc(size_t size, size_t trigger_level);
+void furi_stream_buffer_free(FuriStreamBuffer* buffer);
+size_t furi_stream_buffer_send(
+    FuriStreamBuffer* buffer,
+    const void* data,
+    size_t length,
+    uint32_t timeout);
+size_t furi_stream_buffer_receive(
+    FuriStreamBuffer* buffer,
+    void* data,
+    size_t length,
+    uint32_t timeout);
+size_t furi_stream_buffer_bytes_available(FuriStreamBuffer* buffer);
+size_t furi_stream_buffer_spaces_available(FuriStreamBuffer* buffer);
+FuriStatus furi_stream_buffer_reset(FuriStreamBuffer* buffer);
+
+typedef int32_t (*FuriThreadCallback)(void* context);
+typedef struct FuriThread FuriThread;
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context);
+void furi_thread_free(FuriThread* thread);
+void furi_thread_start(FuriThread* thread);
+bool furi_thread_join(FuriThread* thread);
+
+// Records are not shared between modules on the host; every open returns the same token
+void* furi_record_open(const char* name);
+void furi_record_close(const char* name);
+
+typedef struct FuriString FuriString;
+FuriString* furi_string_alloc(void);
+void furi_string_free(FuriString* string);
+void furi_string_reset(FuriString* string);
+void furi_string_set_str(FuriString* string, const char* text);
+void furi_string_cat_str(FuriString* string, const char* text);
+void furi_string_push_back(FuriString* string, char c);
+void furi_string_printf(FuriString* string, const char* format, ...);
+const char* furi_string_get_cstr(const FuriString* string);
+bool furi_string_empty(const FuriString* string);
+
+// Log lines are dropped; the arguments are still evaluated, but not checked against the
+// format, whose %lu is meant for the firmware's 32-bit longs
+static inline void furi_stub_log(const char* tag, const char* format, ...) {
+    UNUSED(tag);
+    UNUSED(format);
+}
+#define FURI_LOG_E(tag, ...) furi_stub_log(tag, __VA_ARGS__)
+#define FURI_LOG_W(tag, ...) furi_stub_log(tag, __VA_ARGS__)
+#define FURI_LOG_I(tag, ...) furi_stub_log(tag, __VA_ARGS__)
+#define FURI_LOG_D(tag, ...) furi_stub_log(tag, __VA_ARGS__)
+
+// Not in glibc before 2.38
+static inline size_t furi_stub_strlcpy(char* dst, const char* src, size_t size) {
+    size_t length = strlen(src);
+    if(size) {
+        size_t copy = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, copy);
+        dst[copy] = '\0';
+    }
+    return length;
+}
+#define strlcpy furi_stub_strlcpy
@@ -0,0 +1,548 @@
+// The furi primitives and storage calls declared in the stubs, over pthreads and stdio
+
+#include <furi.h>
+#include <storage/storage.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+uint32_t furi_get_tick(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+uint32_t furi_ms_to_ticks(uint32_t ms) {
+    return ms;
+}
+
+void furi_delay_ms(uint32_t ms) {
+    struct timespec delay = {.tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000};
+    while(nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+    }
+}
+
+// Every object below is a lock and a condition; waits end at an absolute deadline
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} HostSync;
+
+static void host_sync_init(HostSync* sync) {
+    pthread_mutex_init(&sync->lock, NULL);
+    pthread_cond_init(&sync->changed, NULL);
+}
+
+static void host_sync_destroy(HostSync* sync) {
+    pthread_cond_destroy(&sync->changed);
+    pthread_mutex_destroy(&sync->lock);
+}
+
+static struct timespec host_deadline(uint32_t timeout) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout / 1000;
+    deadline.tv_nsec += (long)(timeout % 1000) * 1000000;
+    if(deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    return deadline;
+}
+
+// Wait for a change with the lock held; false once 'timeout' has run out
+static bool host_sync_wait(HostSync* sync, uint32_t timeout, const struct timespec* deadline) {
+    if(timeout == 0) return false;
+    if(timeout == FuriWaitForever) return pthread_cond_wait(&sync->changed, &sync->lock) == 0;
+    return pthread_cond_timedwait(&sync->changed, &sync->lock, deadline) == 0;
+}
+
+struct FuriMutex {
+    HostSync sync;
+    pthread_t owner;
+    uint32_t depth;
+};
+
+FuriMutex* furi_mutex_alloc(FuriMutexType type) {
+    UNUSED(type);
+    FuriMutex* mutex = calloc(1, sizeof(FuriMutex));
+    host_sync_init(&mutex->sync);
+    return mutex;
+}
+
+void furi_mutex_free(FuriMutex* mutex) {
+    furi_check(mutex->depth == 0);
+    host_sync_destroy(&mutex->sync);
+    free(mutex);
+}
+
+// Both types nest on the host; the firmware asserts on a normal mutex taken twice
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout) {
+    struct timespec deadline = host_deadline(timeout);
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&mutex->sync.lock);
+    while(mutex->depth > 0 && !pthread_equal(mutex->owner, pthread_self())) {
+        if(!host_sync_wait(&mutex->sync, timeout, &deadline) && mutex->depth > 0) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        mutex->owner = pthread_self();
+        mutex->depth++;
+    }
+    pthread_mutex_unlock(&mutex->sync.lock);
+    return status;
+}
+
+FuriStatus furi_mutex_release(FuriMutex* mutex) {
+    pthread_mutex_lock(&mutex->sync.lock);
+    furi_check(mutex->depth > 0 && pthread_equal(mutex->owner, pthread_self()));
+    if(--mutex->depth == 0) pthread_cond_broadcast(&mutex->sync.changed);
+    pthread_mutex_unlock(&mutex->sync.lock);
+    return FuriStatusOk;
+}
+
+struct FuriSemaphore {
+    HostSync sync;
+    uint32_t max_count;
+    uint32_t count;
+};
+
+FuriSemaphore* furi_semaphore_alloc(uint32_t max_count, uint32_t initial_count) {
+    FuriSemaphore* semaphore = calloc(1, sizeof(FuriSemaphore));
+    host_sync_init(&semaphore->sync);
+    semaphore->max_count = max_count;
+    semaphore->count = initial_count;
+    return semaphore;
+}
+
+void furi_semaphore_free(FuriSemaphore* semaphore) {
+    host_sync_destroy(&semaphore->sync);
+    free(semaphore);
+}
+
+FuriStatus furi_semaphore_acquire(FuriSemaphore* semaphore, uint32_t timeout) {
+    struct timespec deadline = host_deadline(timeout);
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&semaphore->sync.lock);
+    while(semaphore->count == 0) {
+        if(!host_sync_wait(&semaphore->sync, timeout, &deadline) && semaphore->count == 0) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) semaphore->count--;
+    pthread_mutex_unlock(&semaphore->sync.lock);
+    return status;
+}
+
+FuriStatus furi_semaphore_release(FuriSemaphore* semaphore) {
+    FuriStatus status = FuriStatusErrorResource;
+    pthread_mutex_lock(&semaphore->sync.lock);
+    if(semaphore->count < semaphore->max_count) {
+        semaphore->count++;
+        pthread_cond_broadcast(&semaphore->sync.changed);
+        status = FuriStatusOk;
+    }
+    pthread_mutex_unlock(&semaphore->sync.lock);
+    return status;
+}
+
+uint32_t furi_semaphore_get_count(FuriSemaphore* semaphore) {
+    pthread_mutex_lock(&semaphore->sync.lock);
+    uint32_t count = semaphore->count;
+    pthread_mutex_unlock(&semaphore->sync.lock);
+    return count;
+}
+
+struct FuriMessageQueue {
+    HostSync sync;
+    uint32_t msg_count;
+    uint32_t msg_size;
+    uint32_t head;
+    uint32_t used;
+    uint8_t* slots;
+};
+
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size) {
+    FuriMessageQueue* queue = calloc(1, sizeof(FuriMessageQueue));
+    host_sync_init(&queue->sync);
+    queue->msg_count = msg_count;
+    queue->msg_size = msg_size;
+    queue->slots = malloc((size_t)msg_count * msg_size);
+    return queue;
+}
+
+void furi_message_queue_free(FuriMessageQueue* queue) {
+    host_sync_destroy(&queue->sync);
+    free(queue->slots);
+    free(queue);
+}
+
+FuriStatus furi_message_queue_put(FuriMessageQueue* queue, const void* msg, uint32_t timeout) {
+    struct timespec deadline = host_deadline(timeout);
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&queue->sync.lock);
+    while(queue->used == queue->msg_count) {
+        if(!host_sync_wait(&queue->sync, timeout, &deadline) &&
+           queue->used == queue->msg_count) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        uint32_t slot = (queue->head + queue->used) % queue->msg_count;
+        memcpy(queue->slots + (size_t)slot * queue->msg_size, msg, queue->msg_size);
+        queue->used++;
+        pthread_cond_broadcast(&queue->sync.changed);
+    }
+    pthread_mutex_unlock(&queue->sync.lock);
+    return status;
+}
+
+FuriStatus furi_message_queue_get(FuriMessageQueue* queue, void* msg, uint32_t timeout) {
+    struct timespec deadline = host_deadline(timeout);
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&queue->sync.lock);
+    while(queue->used == 0) {
+        if(!host_sync_wait(&queue->sync, timeout, &deadline) && queue->used == 0) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        memcpy(msg, queue->slots + (size_t)queue->head * queue->msg_size, queue->msg_size);
+        queue->head = (queue->head + 1) % queue->msg_count;
+        queue->used--;
+        pthread_cond_broadcast(&queue->sync.changed);
+    }
+    pthread_mutex_unlock(&queue->sync.lock);
+    return status;
+}
+
+FuriStatus furi_message_queue_reset(FuriMessageQueue* queue) {
+    pthread_mutex_lock(&queue->sync.lock);
+    queue->head = 0;
+    queue->used = 0;
+    pthread_cond_broadcast(&queue->sync.changed);
+    pthread_mutex_unlock(&queue->sync.lock);
+    return FuriStatusOk;
+}
+
+struct FuriStreamBuffer {
+    HostSync sync;
+    size_t size;
+    size_t trigger_level;
+    size_t head;
+    size_t used;
+    uint8_t* data;
+};
+
+FuriStreamBuffer* furi_stream_buffer_alloc(size_t size, size_t trigger_level) {
+    FuriStreamBuffer* buffer = calloc(1, sizeof(FuriStreamBuffer));
+    host_sync_init(&buffer->sync);
+    buffer->size = size;
+    buffer->trigger_level = trigger_level ? trigger_level : 1;
+    buffer->data = malloc(size);
+    return buffer;
+}
+
+void furi_stream_buffer_free(FuriStreamBuffer* buffer) {
+    host_sync_destroy(&buffer->sync);
+    free(buffer->data);
+    free(buffer);
+}
+
+// Like the firmware's, the buffer is meant for one writer and one reader
+size_t furi_stream_buffer_send(
+    FuriStreamBuffer* buffer,
+    const void* data,
+    size_t length,
+    uint32_t timeout) {
+    struct timespec deadline = host_deadline(timeout);
+    pthread_mutex_lock(&buffer->sync.lock);
+    while(buffer->used == buffer->size) {
+        if(!host_sync_wait(&buffer->sync, timeout, &deadline) && buffer->used == buffer->size) {
+            break;
+        }
+    }
+    size_t sent = buffer->size - buffer->used;
+    if(sent > length) sent = length;
+    for(size_t i = 0; i < sent; i++) {
+        buffer->data[(buffer->head + buffer->used + i) % buffer->size] = ((const uint8_t*)data)[i];
+    }
+    buffer->used += sent;
+    if(sent) pthread_cond_broadcast(&buffer->sync.changed);
+    pthread_mutex_unlock(&buffer->sync.lock);
+    return sent;
+}
+
+size_t furi_stream_buffer_receive(
+    FuriStreamBuffer* buffer,
+    void* data,
+    size_t length,
+    uint32_t timeout) {
+    struct timespec deadline = host_deadline(timeout);
+    pthread_mutex_lock(&buffer->sync.lock);
+    while(buffer->used < buffer->trigger_level && buffer->used < length) {
+        if(!host_sync_wait(&buffer->sync, timeout, &deadline) &&
+           buffer->used < buffer->trigger_level && buffer->used < length) {
+            break;
+        }
+    }
+    size_t received = buffer->used < length ? buffer->used : length;
+    for(size_t i = 0; i < received; i++) {
+        ((uint8_t*)data)[i] = buffer->data[(buffer->head + i) % buffer->size];
+    }
+    buffer->head = (buffer->head + received) % buffer->size;
+    buffer->used -= received;
+    if(received) pthread_cond_broadcast(&buffer->sync.changed);
+    pthread_mutex_unlock(&buffer->sync.lock);
+    return received;
+}
+
+size_t furi_stream_buffer_bytes_available(FuriStreamBuffer* buffer) {
+    pthread_mutex_lock(&buffer->sync.lock);
+    size_t used = buffer->used;
+    pthread_mutex_unlock(&buffer->sync.lock);
+    return used;
+}
+
+size_t furi_stream_buffer_spaces_available(FuriStreamBuffer* buffer) {
+    pthread_mutex_lock(&buffer->sync.lock);
+    size_t space = buffer->size - buffer->used;
+    pthread_mutex_unlock(&buffer->sync.lock);
+    return space;
+}
+
+FuriStatus furi_stream_buffer_reset(FuriStreamBuffer* buffer) {
+    pthread_mutex_lock(&buffer->sync.lock);
+    buffer->head = 0;
+    buffer->used = 0;
+    pthread_cond_broadcast(&buffer->sync.changed);
+    pthread_mutex_unlock(&buffer->sync.lock);
+    return FuriStatusOk;
+}
+
+struct FuriThread {
+    pthread_t handle;
+    bool started;
+    FuriThreadCallback callback;
+    void* context;
+    int32_t result;
+};
+
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context) {
+    UNUSED(name);
+    UNUSED(stack_size);
+    FuriThread* thread = calloc(1, sizeof(FuriThread));
+    thread->callback = callback;
+    thread->context = context;
+    return thread;
+}
+
+void furi_thread_free(FuriThread* thread) {
+    furi_check(!thread->started);
+    free(thread);
+}
+
+static void* furi_thread_body(void* context) {
+    FuriThread* thread = context;
+    thread->result = thread->callback(thread->context);
+    return NULL;
+}
+
+void furi_thread_start(FuriThread* thread) {
+    furi_check(!thread->started);
+    furi_check(pthread_create(&thread->handle, NULL, furi_thread_body, thread) == 0);
+    thread->started = true;
+}
+
+bool furi_thread_join(FuriThread* thread) {
+    if(thread->started) {
+        pthread_join(thread->handle, NULL);
+        thread->started = false;
+    }
+    return true;
+}
+
+void* furi_record_open(const char* name) {
+    static int record;
+    UNUSED(name);
+    return &record;
+}
+
+void furi_record_close(const char* name) {
+    UNUSED(name);
+}
+
+struct FuriString {
+    char* text;
+    size_t length;
+    size_t capacity;
+};
+
+static void furi_string_reserve(FuriString* string, size_t length) {
+    if(length < string->capacity) return;
+    while(string->capacity <= length) {
+        string->capacity = string->capacity ? string->capacity * 2 : 32;
+    }
+    string->text = realloc(string->text, string->capacity);
+}
+
+FuriString* furi_string_alloc(void) {
+    FuriString* string = calloc(1, sizeof(FuriString));
+    furi_string_reserve(string, 0);
+    string->text[0] = '\0';
+    return string;
+}
+
+void furi_string_free(FuriString* string) {
+    free(string->text);
+    free(string);
+}
+
+void furi_string_reset(FuriString* string) {
+    string->length = 0;
+    string->text[0] = '\0';
+}
+
+void furi_string_set_str(FuriString* string, const char* text) {
+    furi_string_reset(string);
+    furi_string_cat_str(string, text);
+}
+
+void furi_string_cat_str(FuriString* string, const char* text) {
+    size_t length = strlen(text);
+    furi_string_reserve(string, string->length + length);
+    memcpy(string->text + string->length, text, length + 1);
+    string->length += length;
+}
+
+void furi_string_push_back(FuriString* string, char c) {
+    furi_string_reserve(string, string->length + 1);
+    string->text[string->length++] = c;
+    string->text[string->length] = '\0';
+}
+
+void furi_string_printf(FuriString* string, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    furi_check(length >= 0);
+    furi_string_reserve(string, (size_t)length);
+    va_start(args, format);
+    vsnprintf(string->text, (size_t)length + 1, format, args);
+    va_end(args);
+    string->length = (size_t)length;
+}
+
+const char* furi_string_get_cstr(const FuriString* string) {
+    return string->text;
+}
+
+bool furi_string_empty(const FuriString* string) {
+    return string->length == 0;
+}
+
+struct File {
+    FILE* stream;
+};
+
+File* storage_file_alloc(Storage* storage) {
+    UNUSED(storage);
+    return calloc(1, sizeof(File));
+}
+
+void storage_file_free(File* file) {
+    if(file->stream) fclose(file->stream);
+    free(file);
+}
+
+bool storage_file_open(File* file, const char* path, FS_AccessMode access, FS_OpenMode mode) {
+    furi_check(!file->stream);
+    const char* flags = "rb";
+    if(access & FSAM_WRITE) {
+        if(mode & FSOM_CREATE_ALWAYS) {
+            flags = "w+b";
+        } else if(mode & FSOM_OPEN_APPEND) {
+            flags = "a+b";
+        } else {
+            flags = "r+b";
+        }
+    }
+    file->stream = fopen(path, flags);
+    if(!file->stream && (access & FSAM_WRITE) && (mode & (FSOM_OPEN_ALWAYS | FSOM_CREATE_NEW))) {
+        file->stream = fopen(path, "w+b");
+    }
+    return file->stream != NULL;
+}
+
+bool storage_file_close(File* file) {
+    if(!file->stream) return false;
+    bool ok = fclose(file->stream) == 0;
+    file->stream = NULL;
+    return ok;
+}
+
+size_t storage_file_read(File* file, void* buffer, size_t size) {
+    return file->stream ? fread(buffer, 1, size, file->stream) : 0;
+}
+
+size_t storage_file_write(File* file, const void* buffer, size_t size) {
+    return file->stream ? fwrite(buffer, 1, size, file->stream) : 0;
+}
+
+bool storage_file_seek(File* file, uint32_t offset, bool from_start) {
+    return file->stream && fseek(file->stream, offset, from_start ? SEEK_SET : SEEK_CUR) == 0;
+}
+
+uint64_t storage_file_size(File* file) {
+    struct stat info;
+    if(!file->stream) return 0;
+    fflush(file->stream);
+    return fstat(fileno(file->stream), &info) == 0 ? (uint64_t)info.st_size : 0;
+}
+
+bool storage_file_truncate(File* file) {
+    if(!file->stream || fflush(file->stream) != 0) return false;
+    return ftruncate(fileno(file->stream), ftell(file->stream)) == 0;
+}
+
+FS_Error storage_common_stat(Storage* storage, const char* path, FileInfo* info) {
+    UNUSED(storage);
+    struct stat st;
+    if(stat(path, &st) != 0) return FSE_NOT_EXIST;
+    if(info) {
+        info->flags = 0;
+        info->size = (uint64_t)st.st_size;
+    }
+    return FSE_OK;
+}
+
+FS_Error storage_common_timestamp(Storage* storage, const char* path, uint32_t* timestamp) {
+    UNUSED(storage);
+    struct stat st;
+    if(stat(path, &st) != 0) return FSE_NOT_EXIST;
+    *timestamp = (uint32_t)st.st_mtime;
+    return FSE_OK;
+}
+
+FS_Error storage_common_remove(Storage* storage, const char* path) {
+    UNUSED(storage);
+    return remove(path) == 0 ? FSE_OK : FSE_NOT_EXIST;
+}
+
+bool storage_simply_mkdir(Storage* storage, const char* path) {
+    UNUSED(storage);
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
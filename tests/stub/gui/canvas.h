@@ -0,0 +1,53 @@
+#pragma once
+
+// The part of the canvas API the reader draws with. canvas_host.c draws nothing: it hands
+// out fixed glyph widths and counts what it was asked to draw, so benchmarks can check that
+// every redraw really put text on the screen.
+
+#include <furi.h>
+
+typedef struct Canvas Canvas;
+
+typedef enum {
+    FontPrimary,
+    FontSecondary,
+    FontKeyboard,
+    FontBigNumbers,
+} Font;
+
+typedef enum {
+    AlignLeft,
+    AlignRight,
+    AlignTop,
+    AlignBottom,
+    AlignCenter,
+} Align;
+
+typedef enum {
+    ColorWhite,
+    ColorBlack,
+    ColorXOR,
+} Color;
+
+void canvas_set_font(Canvas* canvas, Font font);
+void canvas_set_color(Canvas* canvas, Color color);
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* str);
+void canvas_draw_str_aligned(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    Align horizontal,
+    Align vertical,
+    const char* str);
+size_t canvas_glyph_width(Canvas* canvas, uint16_t symbol);
+void canvas_draw_line(Canvas* canvas, int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+
+// Host only
+typedef struct {
+    uint32_t strings;
+    uint32_t bytes;
+} CanvasHostStats;
+
+Canvas* canvas_host_alloc(void);
+void canvas_host_free(Canvas* canvas);
+void canvas_host_get_stats(const Canvas* canvas, CanvasHostStats* stats);
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <gui/canvas.h>
+
+void elements_scrollbar_pos(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    size_t height,
+    size_t pos,
+    size_t total);
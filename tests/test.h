@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Minimal checks for the host tests: report the first failure and exit non-zero
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if(!(cond)) {                                                                \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while(0)
+
+#define CHECK_EQ(a, b)                                                                        \
+    do {                                                                                      \
+        unsigned long long _a = (unsigned long long)(a);                                      \
+        unsigned long long _b = (unsigned long long)(b);                                      \
+        if(_a != _b) {                                                                        \
+            fprintf(stderr, "%s:%d: %s is %llu, not %llu\n", __FILE__, __LINE__, #a, _a, _b); \
+            exit(1);                                                                          \
+        }                                                                                     \
+    } while(0)
+
+// Deterministic generator, so a failure reproduces on every run
+static inline uint32_t test_random(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
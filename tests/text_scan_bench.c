@@ -0,0 +1,50 @@
+// Throughput of the SWAR kernels in text_scan.c against their byte-at-a-time references
+
+#include "reader/text_scan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_SIZE   (1 << 20)
+#define BENCH_ROUNDS 200
+
+typedef size_t (*ScanFunction)(const uint8_t* data, size_t size);
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Returns MB/s; 'sink' keeps the calls from being optimised away
+static double bench_run(ScanFunction scan, const uint8_t* data, size_t* sink) {
+    double start = bench_now();
+    for(int round = 0; round < BENCH_ROUNDS; round++) {
+        *sink += scan(data, BENCH_SIZE);
+    }
+    double seconds = bench_now() - start;
+    return (double)BENCH_SIZE * BENCH_ROUNDS / (1024 * 1024) / seconds;
+}
+
+int main(void) {
+    // Printable text without a newline, the worst case for both kernels
+    uint8_t* data = malloc(BENCH_SIZE);
+    for(size_t i = 0; i < BENCH_SIZE; i++) {
+        data[i] = 'a' + i % 26;
+    }
+
+    size_t sink = 0;
+    printf(
+        "text_scan_newline       %8.0f MB/s  ref %8.0f MB/s\n",
+        bench_run(text_scan_newline, data, &sink),
+        bench_run(text_scan_newline_ref, data, &sink));
+    printf(
+        "text_scan_count_binary  %8.0f MB/s  ref %8.0f MB/s\n",
+        bench_run(text_scan_count_binary, data, &sink),
+        bench_run(text_scan_count_binary_ref, data, &sink));
+    printf("%zu-bit words (checksum %zu)\n", sizeof(size_t) * 8, sink);
+
+    free(data);
+    return 0;
+}
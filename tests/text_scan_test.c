@@ -0,0 +1,68 @@
+// Differential test of the SWAR kernels in text_scan.c against their byte-at-a-time
+// references, over random buffers at every alignment
+
+#include "test.h"
+#include "reader/text_scan.h"
+#include <string.h>
+
+#define ROUNDS     200000
+#define MAX_LENGTH 100
+#define MAX_SHIFT  8
+
+// Bytes near the class boundaries the masks have to get right
+static const uint8_t edge_bytes[] =
+    {'a', ' ', '~', '\t', '\n', '\r', 0x00, 0x1F, 0x7F, 0x80, 0xFF};
+
+static uint8_t random_byte(uint32_t* seed) {
+    if(test_random(seed) % 4 == 0) return (uint8_t)test_random(seed);
+    return edge_bytes[test_random(seed) % sizeof(edge_bytes)];
+}
+
+static void check_buffer(uint8_t* data, size_t size) {
+    static uint8_t swar[MAX_LENGTH + MAX_SHIFT];
+    static uint8_t ref[MAX_LENGTH + MAX_SHIFT];
+
+    CHECK_EQ(text_scan_newline(data, size), text_scan_newline_ref(data, size));
+    CHECK_EQ(text_scan_count_binary(data, size), text_scan_count_binary_ref(data, size));
+
+    memcpy(swar, data, size);
+    memcpy(ref, data, size);
+    text_scan_clean(swar, size);
+    text_scan_clean_ref(ref, size);
+    CHECK(memcmp(swar, ref, size) == 0);
+}
+
+// Every byte value in every lane of a word, so no mask leaks into its neighbours
+static void test_every_byte(void) {
+    uint8_t data[32];
+    for(size_t lane = 0; lane < 16; lane++) {
+        for(int value = 0; value < 256; value++) {
+            memset(data, 'a', sizeof(data));
+            data[lane] = (uint8_t)value;
+            check_buffer(data, sizeof(data));
+        }
+    }
+}
+
+static void test_random_buffers(void) {
+    // Aligned storage, so 'shift' decides the alignment the kernels see
+    static uint64_t storage[(MAX_LENGTH + MAX_SHIFT) / sizeof(uint64_t) + 1];
+    uint8_t* base = (uint8_t*)storage;
+    uint32_t seed = 0x5eed;
+
+    for(int round = 0; round < ROUNDS; round++) {
+        size_t size = test_random(&seed) % MAX_LENGTH;
+        size_t shift = test_random(&seed) % MAX_SHIFT;
+        for(size_t i = 0; i < size; i++) {
+            base[shift + i] = random_byte(&seed);
+        }
+        check_buffer(base + shift, size);
+    }
+}
+
+int main(void) {
+    test_every_byte();
+    test_random_buffers();
+    printf("text_scan: ok\n");
+    return 0;
+}